@@ -0,0 +1,147 @@
+// Node allocators, plugged into the linked structures as a template policy.
+// A policy Allocator<Node> provides
+//   static Node* allocate();      a value-initialized node
+//   static void free(void* node); usable as a reclamation deleter
+//
+//  - heap: new and delete, the structures' original behaviour,
+//  - pool: per-thread free lists of cache-line-sized blocks carved from
+//          slabs. A thread allocates and frees without synchronizing; nodes
+//          freed by a thread that does not allocate as many (a consumer,
+//          a remover) pile up in its list and go back in batches through
+//          a shared depot, where allocating threads pick them up before
+//          carving a new slab. Every block starts on its own cache line,
+//          so neighbouring nodes never false-share. Slabs are only
+//          returned to the system when the program exits.
+
+#pragma once
+
+#include <stdlib.h>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace alloc {
+
+const size_t CACHE_LINE = 64;
+
+template <typename T>
+struct heap {
+  static T* allocate() { return new T(); }
+  static void free(void* node) { delete static_cast<T*>(node); }
+};
+
+template <typename T>
+class pool {
+ public:
+  static T* allocate() { return new (cache().pop()) T(); }
+
+  static void free(void* node) {
+    static_cast<T*>(node)->~T();
+    cache().push(node);
+  }
+
+ private:
+  static const size_t BLOCK = (sizeof(T) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+  static const size_t SLAB_BLOCKS = 256;
+  static const size_t BATCH = 256;  // blocks a thread hands back at once
+
+  struct block {
+    block* next;
+  };
+
+  // free lists in transit between threads, and every slab for the exit
+  class depot {
+   public:
+    static depot& instance() {
+      static depot d;
+      return d;
+    }
+
+    ~depot() {
+      for (void* slab : slabs) ::free(slab);
+    }
+
+    void put(block* list, size_t count) {
+      std::lock_guard<std::mutex> guard(lock);
+      batches.push_back({list, count});
+    }
+
+    bool take(block*& list, size_t& count) {
+      std::lock_guard<std::mutex> guard(lock);
+      if (batches.empty()) return false;
+      list = batches.back().first;
+      count = batches.back().second;
+      batches.pop_back();
+      return true;
+    }
+
+    void* carve() {
+      void* slab = aligned_alloc(CACHE_LINE, BLOCK * SLAB_BLOCKS);
+      if (!slab) throw std::bad_alloc();
+      std::lock_guard<std::mutex> guard(lock);
+      slabs.push_back(slab);
+      return slab;
+    }
+
+   private:
+    depot() {}
+
+    std::mutex lock;
+    std::vector<std::pair<block*, size_t>> batches;
+    std::vector<void*> slabs;
+  };
+
+  class thread_cache {
+   public:
+    thread_cache() : list(nullptr), count(0) { depot::instance(); }
+
+    ~thread_cache() {
+      if (list) depot::instance().put(list, count);
+    }
+
+    void* pop() {
+      if (!list) refill();
+      block* b = list;
+      list = b->next;
+      count--;
+      return b;
+    }
+
+    void push(void* node) {
+      block* b = static_cast<block*>(node);
+      b->next = list;
+      list = b;
+      if (++count >= 2 * BATCH) {
+        /* keep the most recently freed blocks, they are likely cached */
+        block* last = list;
+        for (size_t i = 1; i < count - BATCH; i++) last = last->next;
+        depot::instance().put(last->next, BATCH);
+        last->next = nullptr;
+        count -= BATCH;
+      }
+    }
+
+   private:
+    void refill() {
+      if (depot::instance().take(list, count)) return;
+      char* slab = static_cast<char*>(depot::instance().carve());
+      for (size_t i = SLAB_BLOCKS; i-- > 0;) {
+        block* b = reinterpret_cast<block*>(slab + i * BLOCK);
+        b->next = list;
+        list = b;
+      }
+      count = SLAB_BLOCKS;
+    }
+
+    block* list;
+    size_t count;
+  };
+
+  static thread_cache& cache() {
+    thread_local thread_cache c;
+    return c;
+  }
+};
+
+}  // namespace alloc
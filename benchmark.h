@@ -9,69 +9,524 @@
 #include <chrono>
 #include <random>
 #include <thread>
+#include <type_traits>
 #include <vector>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <pthread.h>
+#include <unistd.h>
+#include <string>
+#include <unordered_map>
+
+#include "configuration.h"
+#include "histogram.h"
+#include "mcas/backoff.h"
+#include "mcas/stats.h"
+#include "perf_counters.h"
+#include "reclaim/reclaim.h"
+#include "results.h"
+#include "roi.h"
+#include "statistics.h"
 
 enum class worker_status {wait, work, finish};
 
-static const int RANDOM_VALUE_RANGE_MIN = 0;
-static const int RANDOM_VALUE_RANGE_MAX = 65536;
+/* wyrand by Wang Yi: a single multiply per number, so the generator stays
+ * negligible next to the data structure operation being measured */
+class wyrand {
+ public:
+  explicit wyrand(uint64_t seed) : state(seed) {}
 
-/* template is used to allow functions/functors of any signature */
-template<typename Function>
-void worker(unsigned int random_seed, unsigned int n_ops, Function fun) {
-  /* set up random number generator */
-  std::mt19937 engine(random_seed);
-  std::uniform_int_distribution<int> uniform_dist(RANDOM_VALUE_RANGE_MIN, RANDOM_VALUE_RANGE_MAX);
+  uint64_t operator()() {
+    state += 0xa0761d6478bd642full;
+    __uint128_t m = static_cast<__uint128_t>(state) * (state ^ 0xe7037ed1a0b428dbull);
+    return static_cast<uint64_t>(m >> 64) ^ static_cast<uint64_t>(m);
+  }
+
+ private:
+  uint64_t state;
+};
+
+/* replays a random stream that was generated before the clock started,
+ * wrapping around when a time-bounded run outlasts it */
+class stream_replay {
+ public:
+  explicit stream_replay(const std::vector<uint64_t>& stream) : stream(stream), next(0) {}
+
+  uint64_t operator()() {
+    auto random = stream[next];
+    if (++next == stream.size()) next = 0;
+    return random;
+  }
+
+ private:
+  const std::vector<uint64_t>& stream;
+  size_t next;
+};
+
+/* --dist sequential: the low half of every random number counts the
+ * thread's operations instead, so each thread walks the key range from 0 in
+ * every trial, while the high half still picks the operation */
+template<typename Source>
+class sequential_keys {
+ public:
+  explicit sequential_keys(Source& source) : source(source), next(0) {}
+
+  uint64_t operator()() { return (source() & ~0xffffffffull) | next++; }
+
+ private:
+  Source& source;
+  uint32_t next;
+};
+
+inline std::vector<uint64_t> generate_stream(uint64_t random_seed, unsigned int n_ops) {
+  wyrand engine(random_seed);
+  std::vector<uint64_t> stream(std::max(n_ops, 1u));
+  for (auto& random : stream) random = engine();
+  return stream;
+}
+
+using benchmark_clock = std::chrono::high_resolution_clock;
+
+struct alignas(64) thread_stats {
+  benchmark_clock::time_point start;
+  benchmark_clock::time_point stop;
+  unsigned long ops;
+  std::vector<latency_histogram> latency;  // one per operation kind
+  std::vector<unsigned long> calls;        // operations per kind
+  std::vector<double> counters;            // one per perf event, negative if unavailable
+  mcas::stats::counters mcas;
+  std::unordered_map<const void*, uint64_t> conflicts;  // sampled, by address
+};
+
+/* calls the phase function, counts the operation kind it reports and times
+ * every sample-th call into the histogram of that kind; sample 0 disables
+ * timing altogether */
+class latency_recorder {
+ public:
+  latency_recorder(unsigned int sample, size_t n_kinds)
+      : histograms(sample ? n_kinds : 0), calls(n_kinds), sample(sample), countdown(sample) {}
+
+  template<typename Function>
+  void operator()(Function& fun, uint64_t random) {
+    if (sample == 0 || --countdown != 0) {
+      calls[fun(random)]++;
+      mcas::stats::end_operation();
+      return;
+    }
+    countdown = sample;
+    auto start = std::chrono::steady_clock::now();
+    unsigned int kind = fun(random);
+    auto stop = std::chrono::steady_clock::now();
+    mcas::stats::end_operation();
+    calls[kind]++;
+    histograms[kind].record(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+  }
+
+  std::vector<latency_histogram> histograms;
+  std::vector<unsigned long> calls;
 
+ private:
+  unsigned int sample;
+  unsigned int countdown;
+};
+
+/* template is used to allow functions/functors of any signature */
+template<typename Source, typename Function>
+void worker(Source& source, unsigned int n_ops, latency_recorder& call, perf_counters& counters,
+            thread_stats& stats, Function fun) {
+  mcas::stats::local().reset();
+  mcas::stats::conflicts().clear();
+  mcas::backoff::reset();
+  counters.start();
+  stats.start = benchmark_clock::now();
   for (unsigned int i = 0; i < n_ops; i++) {
-    auto random = uniform_dist(engine);
+    auto random = source();
     /* do specified work */
-    fun(random);
+    call(fun, random);
   }
+  stats.stop = benchmark_clock::now();
+  counters.stop();
+  stats.ops = n_ops;
 }
 
+/* time-bounded worker: runs until status is finish, counting only the
+ * operations completed while status is work (wait is the warmup) */
+template<typename Source, typename Function>
+void worker(Source& source, const std::atomic<worker_status>& status, latency_recorder& call,
+            perf_counters& counters, thread_stats& stats, Function fun) {
+  while (status.load(std::memory_order_relaxed) == worker_status::wait) fun(source());
 
-template<typename Function>
-void benchmark(unsigned int threadcnt, unsigned int n_ops,
-               const std::string& identifier, Function fun) {
-  auto n_ops_per_thread = n_ops / threadcnt;
-  /* spawn workers */
-  std::vector<std::thread*> workers;
-  std::random_device rd;
+  unsigned long ops = 0;
+  mcas::stats::local().reset();
+  mcas::stats::conflicts().clear();
+  mcas::backoff::reset();
+  counters.start();
+  stats.start = benchmark_clock::now();
+  while (status.load(std::memory_order_relaxed) == worker_status::work) {
+    call(fun, source());
+    ops++;
+  }
+  stats.stop = benchmark_clock::now();
+  counters.stop();
+  stats.ops = ops;
+}
 
-  using clock = std::chrono::high_resolution_clock;
-  std::chrono::time_point<clock> start_time = clock::now();
-
-  for(unsigned int i = 0; i < threadcnt-1; i++) {
-    auto seed = rd();
-    auto w = new std::thread([seed, n_ops_per_thread, fun]() { worker(seed, n_ops_per_thread, fun); });
-    workers.push_back(w);
-    // set thread affinity for workers
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(i+1, &cpuset);
-    pthread_setaffinity_np(workers[i]->native_handle(), sizeof(cpu_set_t), &cpuset);
-  };
 
-  // set thread affinity for main thread
+/* one-shot barrier: the last thread to arrive runs on_release, then
+ * releases all others */
+class spin_barrier {
+ public:
+  explicit spin_barrier(unsigned int n) : waiting(n), released(false) {}
+
+  void arrive_and_wait() {
+    arrive_and_wait([]() {});
+  }
+
+  template<typename Completion>
+  void arrive_and_wait(Completion on_release) {
+    if (waiting.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      on_release();
+      released.store(true, std::memory_order_release);
+    } else {
+      while (!released.load(std::memory_order_acquire)) std::this_thread::yield();
+    }
+  }
+
+ private:
+  std::atomic<unsigned int> waiting;
+  std::atomic<bool> released;
+};
+
+inline void pin_thread(unsigned int cpu) {
   cpu_set_t cpuset;
   CPU_ZERO(&cpuset);
-  CPU_SET(0, &cpuset);
+  CPU_SET(cpu, &cpuset);
   pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+/* outcome of one run of a benchmark phase */
+struct trial_result {
+  unsigned int threads;
+  unsigned long ops;
+  double time;                     // makespan in ms
+  double throughput;               // Mops/s
+  std::vector<double> per_thread;  // Mops/s
+  std::vector<latency_histogram> latency;  // one per operation kind
+  std::vector<unsigned long> calls;        // operations per kind, summed over threads
+  std::vector<double> counters;            // summed over threads, negative if unavailable
+  mcas::stats::counters mcas;              // merged over threads
+  mcas::stats::heatmap heatmap;            // sampled conflicts, merged over threads
+};
+
+/* fun performs one operation and returns its kind, an index into the
+ * n_kinds operation names of the phase */
+template<typename Function>
+trial_result run_trial(const Configuration& config, const std::string& phase, size_t n_kinds,
+                       Function fun) {
+  auto threadcnt = config.n_threads;
+  auto n_ops_per_thread = config.n_ops / threadcnt;
+  bool pregenerate = config.pregenerate;
+  bool timed = config.duration > 0;
+  bool sequential = config.key_dist == Configuration::KeyDistribution::SEQUENTIAL;
+  std::random_device rd;
+
+  std::vector<uint64_t> seeds(threadcnt);
+  for (auto& seed : seeds) seed = (static_cast<uint64_t>(rd()) << 32) | rd();
 
-  worker(rd(), n_ops_per_thread, fun);
+  std::vector<thread_stats> stats(threadcnt);
+  mcas::stats::heatmap_sample() = config.heatmap_sample;
+  mcas::backoff::current() = {static_cast<mcas::backoff::Policy>(config.backoff), config.backoff_pause,
+                              config.backoff_min, config.backoff_max};
+  auto events = perf_event_specs(config);
+  std::atomic<worker_status> status(worker_status::wait);
+  /* in a time-bounded run the timekeeper starts together with the workers */
+  spin_barrier start_barrier(timed ? threadcnt + 1 : threadcnt);
+  /* with a fixed op count the region of interest opens when the barrier
+   * releases the workers and closes when the last of them is done */
+  std::atomic<unsigned int> running(threadcnt);
+
+  /* threads pin themselves and prepare their input, then start together;
+   * only the work after the barrier is timed */
+  auto run = [&](unsigned int id) {
+    pin_thread(id);
+    wyrand engine(seeds[id]);
+    std::vector<uint64_t> stream;
+    if (pregenerate) stream = generate_stream(seeds[id], n_ops_per_thread);
+    stream_replay replay(stream);
+    latency_recorder call(config.latency_sample, n_kinds);
+    perf_counters counters(events);
+
+    if (timed) start_barrier.arrive_and_wait();
+    else start_barrier.arrive_and_wait([&]() { roi::begin(config, phase); });
+    auto work = [&](auto& source) {
+      if (timed) worker(source, status, call, counters, stats[id], fun);
+      else worker(source, n_ops_per_thread, call, counters, stats[id], fun);
+    };
+    auto work_from = [&](auto& source) {
+      if (!sequential) return work(source);
+      sequential_keys<typename std::remove_reference<decltype(source)>::type> keys(source);
+      work(keys);
+    };
+    if (pregenerate) work_from(replay);
+    else work_from(engine);
+    if (!timed && running.fetch_sub(1, std::memory_order_acq_rel) == 1) roi::end(config, phase);
+    stats[id].latency = std::move(call.histograms);
+    stats[id].calls = std::move(call.calls);
+    stats[id].counters = counters.read();
+    stats[id].mcas = mcas::stats::local();
+    stats[id].conflicts = std::move(mcas::stats::conflicts());
+  };
+
+  std::thread timekeeper;
+  if (timed) {
+    timekeeper = std::thread([&]() {
+      using seconds = std::chrono::duration<double>;
+      start_barrier.arrive_and_wait();
+      std::this_thread::sleep_for(seconds(config.warmup));
+      /* in a time-bounded run the region of interest is the measured
+       * window, warmup excluded */
+      roi::begin(config, phase);
+      status.store(worker_status::work, std::memory_order_relaxed);
+      std::this_thread::sleep_for(seconds(config.duration));
+      status.store(worker_status::finish, std::memory_order_relaxed);
+      roi::end(config, phase);
+    });
+  }
+
+  /* spawn workers, the main thread runs as thread 0 */
+  std::vector<std::thread> workers;
+  for (unsigned int i = 1; i < threadcnt; i++) workers.emplace_back(run, i);
+  run(0);
 
   /* make sure all workers terminated */
-  for(auto& w : workers) {
-    w->join();
-    delete w;
+  for (auto& w : workers) w.join();
+  if (timed) timekeeper.join();
+
+  /* makespan: first thread started measuring to last thread finished */
+  auto start_time = stats[0].start;
+  auto end_time = stats[0].stop;
+  unsigned long total_ops = 0;
+  for (auto& t : stats) {
+    start_time = std::min(start_time, t.start);
+    end_time = std::max(end_time, t.stop);
+    total_ops += t.ops;
+  }
+
+  using milliseconds = std::chrono::duration<double, std::milli>;
+  trial_result result;
+  result.threads = threadcnt;
+  result.ops = total_ops;
+  result.time = milliseconds(end_time - start_time).count();
+  result.throughput = total_ops / result.time / 1000;
+  for (auto& t : stats)
+    result.per_thread.push_back(t.ops / milliseconds(t.stop - t.start).count() / 1000);
+  result.latency.resize(stats[0].latency.size());
+  for (auto& t : stats)
+    for (size_t k = 0; k < t.latency.size(); k++) result.latency[k].merge(t.latency[k]);
+  result.calls.assign(n_kinds, 0);
+  for (auto& t : stats)
+    for (size_t k = 0; k < n_kinds; k++) result.calls[k] += t.calls[k];
+  /* an event counts only if every thread could count it */
+  result.counters.assign(events.size(), 0);
+  for (auto& t : stats)
+    for (size_t e = 0; e < events.size(); e++)
+      result.counters[e] = t.counters[e] < 0 || result.counters[e] < 0 ? -1 : result.counters[e] + t.counters[e];
+  for (auto& t : stats) result.mcas.merge(t.mcas);
+  /* addresses are named now, while the structure they point into exists */
+  std::unordered_map<const void*, uint64_t> conflicts;
+  for (auto& t : stats)
+    for (auto& c : t.conflicts) conflicts[c.first] += c.second;
+  result.heatmap.add(conflicts);
+  return result;
+}
+
+/* perf counts per operation over all runs of a phase, negative if an
+ * event was unavailable in any of them */
+inline std::vector<double> counters_per_op(const std::vector<trial_result>& trials) {
+  std::vector<double> per_op(trials[0].counters.size(), 0);
+  unsigned long ops = 0;
+  for (auto& t : trials) {
+    ops += t.ops;
+    for (size_t e = 0; e < per_op.size(); e++)
+      per_op[e] = t.counters[e] < 0 || per_op[e] < 0 ? -1 : per_op[e] + t.counters[e];
+  }
+  for (auto& count : per_op)
+    if (count >= 0) count = ops ? count / ops : 0;
+  return per_op;
+}
+
+inline void report(const Configuration& config, const std::string& identifier,
+                   const std::vector<std::string>& op_names, const std::vector<trial_result>& trials) {
+  console() << identifier << std::endl;
+  for (auto& t : trials) {
+    console() << u8"\tthreads: " << t.threads
+              << u8" - ops: " << t.ops
+              << u8" - time: " << t.time << "ms"
+              << u8" - throughput: " << t.throughput << " Mops/s" << "\n";
+    console() << u8"\tper-thread Mops/s:";
+    for (double x : t.per_thread) console() << " " << x;
+    console() << "\n";
+    if (t.calls.size() > 1) {
+      console() << u8"\tops per kind:";
+      for (size_t k = 0; k < t.calls.size(); k++)
+        console() << (k ? u8" - " : u8" ") << op_names[k] << " " << t.calls[k];
+      console() << "\n";
+    }
+  }
+
+  if (trials.size() > 1) {
+    std::vector<double> throughput;
+    for (auto& t : trials) throughput.push_back(t.throughput);
+    summary s = summarize(throughput);
+    scaling_table::instance().add(config, identifier, config.n_threads, s.mean);
+    console() << u8"\tthroughput over " << s.n << u8" runs (Mops/s):"
+              << u8" mean " << s.mean << u8" - median " << s.median
+              << u8" - stddev " << s.stddev
+              << u8" - min " << s.min << u8" - max " << s.max
+              << u8" - 95% CI [" << s.mean - s.ci95 << ", " << s.mean + s.ci95 << "]\n";
+  } else {
+    scaling_table::instance().add(config, identifier, config.n_threads, trials[0].throughput);
+  }
+
+  for (size_t i = 0; i < trials.size(); i++) {
+    auto& t = trials[i];
+    std::vector<double> per_op = counters_per_op({t});
+    result_writer::instance().write(config, {identifier, static_cast<unsigned int>(i), t.threads, t.ops,
+                                     t.time, t.throughput, t.per_thread, op_names, t.calls, t.latency,
+                                     per_op});
+  }
+
+  auto events = perf_event_specs(config);
+  if (!events.empty()) {
+    auto per_op = counters_per_op(trials);
+    bool any = false;
+    for (double count : per_op) any |= count >= 0;
+    if (any) {
+      console() << u8"\tper op:";
+      for (size_t e = 0; e < events.size(); e++) {
+        console() << (e ? u8" - " : u8" ") << events[e].name << " ";
+        if (per_op[e] < 0) console() << "n/a";
+        else console() << per_op[e];
+      }
+      console() << "\n";
+    } else {
+      console() << u8"\tperf counters unavailable: "
+                << strerror(perf_counters::last_error().load())
+                << " (see /proc/sys/kernel/perf_event_paranoid)\n";
+    }
+  }
+
+  /* MCAS failure rates and retries are reported over all runs of the phase */
+  mcas::stats::counters mcas_stats;
+  for (auto& t : trials) mcas_stats.merge(t.mcas);
+  if (mcas_stats.total_calls() > 0) {
+    static const char* const arity_names[] = {"", "cas", "dcas", "tcas", "qcas"};
+    console() << u8"\tmcas:";
+    for (int k = 1; k <= mcas::MAX_WORDS; k++) {
+      if (mcas_stats.calls[k] == 0) continue;
+      if (k <= 4) console() << " " << arity_names[k];
+      else console() << " " << k << "-cas";
+      console() << " " << mcas_stats.calls[k] << " calls, "
+                << mcas_stats.calls[k] - mcas_stats.failures[k] << " ok, "
+                << mcas_stats.failures[k] << " failed ("
+                << 100.0 * mcas_stats.failures[k] / mcas_stats.calls[k] << "%) -";
+    }
+    console() << u8" total failure rate "
+              << 100.0 * mcas_stats.total_failures() / mcas_stats.total_calls() << "%\n";
+    int last = mcas::stats::RETRY_BUCKETS - 1;
+    console() << u8"\tmcas retries per op:"
+              << u8" p50 " << mcas_stats.retries_percentile(0.5)
+              << u8" - p90 " << mcas_stats.retries_percentile(0.9)
+              << u8" - p99 " << mcas_stats.retries_percentile(0.99)
+              << u8" - ops " << mcas_stats.operations() << u8" - histogram";
+    for (int r = 0; r <= last; r++)
+      if (mcas_stats.retries[r])
+        console() << " " << r << (r == last ? "+" : "") << ":" << mcas_stats.retries[r];
+    console() << "\n";
+  }
+
+  mcas::stats::heatmap heatmap;
+  for (auto& t : trials) heatmap.merge(t.heatmap);
+  if (!heatmap.words.empty()) {
+    console() << u8"\tmcas hot words (sampled conflicts):\n";
+    for (auto& w : mcas::stats::heatmap::top(heatmap.words, config.heatmap_top))
+      console() << u8"\t\t" << w.second << " " << w.first << "\n";
+    console() << u8"\tmcas hot cache lines (sampled conflicts):\n";
+    for (auto& l : mcas::stats::heatmap::top(heatmap.lines, config.heatmap_top))
+      console() << u8"\t\t" << l.second << " " << l.first << "\n";
   }
-  std::chrono::time_point<clock> end_time = clock::now();
-  workers.clear();
 
-  long time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
-  std::cout << identifier << std::endl << u8"\tthreads: " << threadcnt
-            << u8" - ops: " << n_ops
-            << u8" - time: " << time << "ms" << "\n";
+  /* latency is reported over all runs of the phase */
+  std::vector<latency_histogram> latency(trials[0].latency.size());
+  for (auto& t : trials)
+    for (size_t k = 0; k < t.latency.size(); k++) latency[k].merge(t.latency[k]);
+  for (size_t k = 0; k < latency.size(); k++) {
+    auto& h = latency[k];
+    if (h.count() == 0) continue;
+    console() << u8"\tlatency " << op_names[k] << u8" (ns):"
+              << u8" p50 " << h.percentile(0.5) << u8" - p90 " << h.percentile(0.9)
+              << u8" - p99 " << h.percentile(0.99) << u8" - p99.9 " << h.percentile(0.999)
+              << u8" - max " << h.max() << u8" - samples " << h.count() << "\n";
+  }
+}
+
+/* resident set size of the process in MiB */
+inline double resident_mib() {
+  std::ifstream statm("/proc/self/statm");
+  long size = 0, resident = 0;
+  statm >> size >> resident;
+  return resident * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024 * 1024);
+}
+
+inline void report_resident(double before) {
+  console() << u8"\tresident memory (MiB): before " << before << u8" - after " << resident_mib() << "\n";
+}
+
+/* the thread counts a phase runs with: the sweep if one was given */
+inline std::vector<unsigned int> thread_counts(const Configuration& config) {
+  if (config.thread_sweep.empty()) return {config.n_threads};
+  return config.thread_sweep;
+}
+
+/* runs the phase n_iter times for every thread count */
+template<typename Function>
+void benchmark(const Configuration& config, const std::string& identifier,
+               const std::vector<std::string>& op_names, Function fun) {
+  for (unsigned int threads : thread_counts(config)) {
+    Configuration run_config = config;
+    run_config.n_threads = threads;
+    double resident = resident_mib();
+    std::vector<trial_result> trials;
+    for (unsigned int i = 0; i < config.n_iter; i++)
+      trials.push_back(run_trial(run_config, identifier, op_names.size(), fun));
+    report(run_config, identifier, op_names, trials);
+    report_resident(resident);
+  }
+}
+
+/* runs the phase n_iter times for every thread count, each time on a fresh
+ * structure from make(), so no run sees the state left behind by another */
+template<typename Make, typename Function>
+void benchmark(const Configuration& config, const std::string& identifier,
+               const std::vector<std::string>& op_names, Make make, Function fun) {
+  for (unsigned int threads : thread_counts(config)) {
+    Configuration run_config = config;
+    run_config.n_threads = threads;
+    double resident = resident_mib();
+    std::vector<trial_result> trials;
+    for (unsigned int i = 0; i < config.n_iter; i++) {
+      auto structure = [&]() {
+        roi::region prefill(run_config, "prefill");
+        return make();
+      }();
+      trials.push_back(run_trial(run_config, identifier, op_names.size(),
+                                 [&structure, &fun](uint64_t random) { return fun(*structure, random); }));
+      /* the workers are gone, so whatever they retired can be freed now */
+      structure.reset();
+      reclaim::drain();
+    }
+    report(run_config, identifier, op_names, trials);
+    report_resident(resident);
+  }
 }
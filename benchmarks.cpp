@@ -1,10 +1,15 @@
-#ifdef ENABLE_PARSEC_HOOKS
-#include <hooks.h>
-#endif
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
 
 #include "benchmarks.h"
 #include "benchmark.h"
 #include "configuration.h"
+#include "distribution.h"
+#include "padding.h"
 
 #include "lockbased/Deque.h"
 #include "lockbased/HashMap.h"
@@ -19,537 +24,714 @@
 #include "lockfree/HashMap.h"
 #include "lockfree/Deque.h"
 #include "lockfree/Stack.h"
+#include "lockfree/FAAQueue.h"
 #include "lockfree/Queue.h"
+#include "lockfree/RingQueue.h"
+#include "lockfree/SPSCQueue.h"
 
 #include "lockfree-mcas/BinarySearchTree.h"
 #include "lockfree-mcas/Deque.h"
 #include "lockfree-mcas/HashMap.h"
 #include "lockfree-mcas/Queue.h"
+#include "lockfree-mcas/RingQueue.h"
 #include "lockfree-mcas/SortedList.h"
 #include "lockfree-mcas/Stack.h"
 #include "lockfree-mcas/array_swap.h"
 
-static const int DATA_VALUE_RANGE_MIN = 0;
-static const int DATA_VALUE_RANGE_MAX = 256;
-static const int DATA_PREFILL = 1024;
+/* operation kinds: phase functions return the kind they performed, an index
+ * into the operation names the phase reports latencies under */
+enum SetOp { INSERT, REMOVE, LOOKUP };
+enum QueueOp { PUSH, POP, STEAL, PUSH_FULL = STEAL };  // queues do not steal
+enum DequeOp { PUSH_BACK, PUSH_FRONT, POP_BACK, POP_FRONT };
+
+/* keys and operation kinds of one phase, both drawn from a single random
+ * number: the key from the low bits, the operation from the high bits */
+class Workload {
+ public:
+  Workload(std::shared_ptr<const key_distribution> keys,
+           const Configuration::OpMix& mix)
+      : keys(keys), mix(mix) {}
+
+  long key(uint64_t random) const { return (*keys)(random); }
+
+  SetOp op(uint64_t random) const {
+    unsigned int choice = (random >> 32) % mix.total();
+    if (choice < mix.insert) return INSERT;
+    if (choice < mix.insert + mix.remove) return REMOVE;
+    return LOOKUP;
+  }
+
+ private:
+  std::shared_ptr<const key_distribution> keys;
+  Configuration::OpMix mix;
+};
+
+typedef std::vector<std::pair<std::string, Workload>> Phases;
+
+/* read (100% lookup), update (50% insert, 50% remove) and mixed (80% lookup,
+ * 10% insert, 10% remove), or the single phase given by --mix */
+Phases set_phases(const Configuration& config) {
+  auto keys = std::make_shared<const key_distribution>(config, config.key_range);
+  if (config.mix.total() > 0) return {{"mix", Workload(keys, config.mix)}};
+  return {{"read", Workload(keys, {0, 0, 1})},
+          {"update", Workload(keys, {1, 1, 0})},
+          {"mixed", Workload(keys, {1, 1, 8})}};
+}
+
+/* containers without lookup run their insert:remove share of --mix, or the
+ * 50/50 update phase */
+Phases update_phases(const Configuration& config) {
+  auto keys = std::make_shared<const key_distribution>(config, config.key_range);
+  Configuration::OpMix mix = {config.mix.insert, config.mix.remove, 0};
+  if (mix.total() > 0) return {{"mix", Workload(keys, mix)}};
+  return {{"update", Workload(keys, {1, 1, 0})}};
+}
+
+static const size_t CACHE_LINE_SIZE = 64;
+static const size_t PAGE_SIZE = 4096;
+
+/* mwobject_width counters placed according to mwobject_spread */
+class MWObject {
+ public:
+  explicit MWObject(const Configuration& config)
+      : words(config.mwobject_width) {
+    size_t stride = sizeof(uint64_t);
+    if (config.mwobject_spread == Configuration::MWObjectSpread::LINE)
+      stride = CACHE_LINE_SIZE;
+    if (config.mwobject_spread == Configuration::MWObjectSpread::PAGE)
+      stride = PAGE_SIZE;
+
+    if (posix_memalign(&buffer, PAGE_SIZE, stride * words.size()) != 0)
+      throw std::bad_alloc();
+    memset(buffer, 0, stride * words.size());
+    for (size_t i = 0; i < words.size(); i++)
+      words[i] = reinterpret_cast<uint64_t*>(static_cast<char*>(buffer) +
+                                             i * stride);
+    mcas::stats::label_array(this, buffer, words.size(), stride, "MWObject::words");
+  }
+
+  ~MWObject() {
+    mcas::stats::forget(this);
+    free(buffer);
+  }
+
+  std::vector<uint64_t*> words;
+
+ private:
+  void* buffer;
+};
+
+template <int W>
+bool mwobject_kcas_increment(uint64_t* const* words) {
+  mcas::Word update[W];
+  for (int i = 0; i < W; i++) {
+    uint64_t old_val = mcas_read(words[i]);
+    update[i] = {words[i], old_val, old_val + 1};
+  }
+  return kcas(update);
+}
+
+typedef bool (*MWObjectUpdate)(uint64_t* const* words);
+
+/* picks the kcas<W> instantiation matching a runtime width */
+template <int... W>
+MWObjectUpdate mwobject_kcas_update(unsigned int width,
+                                    std::integer_sequence<int, W...>) {
+  static const MWObjectUpdate updates[] = {mwobject_kcas_increment<W + 1>...};
+  return updates[width - 1];
+}
 
 void benchmark_mwobject(const Configuration& config) {
-  struct {
-    uint64_t a;
-    uint64_t b;
-    uint64_t c;
-    uint64_t d;
-  } counters{};
+  MWObject counters(config);
   std::mutex counters_lock;
 
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_begin();
-#endif
   {
-    benchmark(config.n_threads, config.n_ops, u8"Update", [&counters, &counters_lock](int random) {
+    benchmark(config, u8"Update", {"update"},
+              [&counters, &counters_lock](uint64_t random) {
       std::lock_guard<std::mutex> lock(counters_lock);
-      counters.a++;
-      counters.b++;
-      counters.c++;
-      counters.d++;
+      for (uint64_t* word : counters.words) (*word)++;
+      return 0;
     });
   }
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_end();
-#endif
 
 }
 
 void benchmark_mcas_mwobject(const Configuration& config) {
-  struct {
-    uint64_t a;
-    uint64_t b;
-    uint64_t c;
-    uint64_t d;
-  } counters{};
-
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_begin();
-#endif
+  if (config.mwobject_width > mcas::BACKEND_MAX_WORDS) {
+    std::cerr << "width " << config.mwobject_width
+              << " exceeds the MCAS backend limit of "
+              << mcas::BACKEND_MAX_WORDS << " words" << std::endl;
+    return;
+  }
+  MWObject counters(config);
+  uint64_t* const* words = counters.words.data();
+  MWObjectUpdate update = mwobject_kcas_update(
+      config.mwobject_width,
+      std::make_integer_sequence<int, mcas::BACKEND_MAX_WORDS>());
+
   {
-    benchmark(config.n_threads, config.n_ops, u8"Update", [&counters](int random) {
+    benchmark(config, u8"Update", {"update"}, [words, update](uint64_t random) {
       while (true) {
-        uint64_t old_a = counters.a;
-        uint64_t old_b = counters.b;
-        uint64_t old_c = counters.c;
-        uint64_t old_d = counters.d;
-
-        uint64_t new_a = old_a + 1;
-        uint64_t new_b = old_b + 1;
-        uint64_t new_c = old_c + 1;
-        uint64_t new_d = old_d + 1;
-
-        {
-          if (qcas(reinterpret_cast<uint64_t*>(&counters.a), old_a, new_a,
-                   reinterpret_cast<uint64_t*>(&counters.b), old_b, new_b,
-                   reinterpret_cast<uint64_t*>(&counters.c), old_c, new_c,
-                   reinterpret_cast<uint64_t*>(&counters.d), old_d, new_d))
-            break;
-        }
+        if (update(words)) break;
       }
+      return 0;
     });
   }
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_end();
-#endif
 
 }
 
 void benchmark_arrayswap(const Configuration& config) {
+  {
+    roi::region prefill(config, "prefill");
     lockbased::ArraySwap::initialize();
+  }
 
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_begin();
-#endif
   {
-    benchmark(config.n_threads, config.n_ops, u8"swap", [](int random) {
-      /* set up random number generator */
-      std::random_device rd;
-      std::mt19937 engine(rd());
-      std::uniform_int_distribution<int> uniform_dist(0, lockbased::ArraySwap::NUM_ROWS-1);
-
-      int index_a = uniform_dist(engine);
-      int index_b = uniform_dist(engine);
+    key_distribution rows(config, lockbased::ArraySwap::NUM_ROWS);
+    benchmark(config, u8"swap", {"swap"}, [&rows](uint64_t random) {
+      /* two independent row indices from one draw */
+      int index_a = rows(random);
+      int index_b = rows(remix(random));
       lockbased::ArraySwap::swap(index_a, index_b);
+      return 0;
     });
   }
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_end();
-#endif
 
   lockbased::ArraySwap::datum_free(lockbased::ArraySwap::S);
 }
 
 void benchmark_mcas_arrayswap(const Configuration& config) {
-  lockfree_mcas::ArraySwap::initialize();
+  {
+    roi::region prefill(config, "prefill");
+    lockfree_mcas::ArraySwap::initialize();
+  }
 
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_begin();
-#endif
   {
-    benchmark(config.n_threads, config.n_ops, u8"swap", [](int random) {
-      /* set up random number generator */
-      std::random_device rd;
-      std::mt19937 engine(rd());
-      std::uniform_int_distribution<int> uniform_dist(0, lockfree_mcas::ArraySwap::NUM_ROWS-1);
-
-      int index_a = uniform_dist(engine);
-      int index_b = uniform_dist(engine);
+    key_distribution rows(config, lockfree_mcas::ArraySwap::NUM_ROWS);
+    benchmark(config, u8"swap", {"swap"}, [&rows](uint64_t random) {
+      /* two independent row indices from one draw */
+      int index_a = rows(random);
+      int index_b = rows(remix(random));
       lockfree_mcas::ArraySwap::swap(index_a, index_b);
+      return 0;
     });
   }
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_end();
-#endif
 
   lockfree_mcas::ArraySwap::datum_free(lockfree_mcas::ArraySwap::S);
 }
 
 template <typename Deque>
-void benchmark_deque(Deque& deque, const Configuration& config) {
+void benchmark_deque(const Configuration& config) {
   /* set up random number generator */
   std::random_device rd;
   std::mt19937 engine(rd());
-  std::uniform_int_distribution<int> uniform_dist(DATA_VALUE_RANGE_MIN,
-                                                  DATA_VALUE_RANGE_MAX);
+  std::uniform_int_distribution<long> uniform_dist(0, config.key_range - 1);
 
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_begin();
-#endif
   {
-    // prefill deque with 1024 elements
-    for (int i = 0; i < DATA_PREFILL; i++) {
-      deque.push_back(uniform_dist(engine));
-    }
-
-    benchmark(config.n_threads, config.n_ops, u8"update", [&deque](int random) {
-      auto choice1 =
-          (random % (2 * DATA_VALUE_RANGE_MAX)) / DATA_VALUE_RANGE_MAX;
-      auto choice2 =
-          (random % (2 * DATA_VALUE_RANGE_MAX)) / DATA_VALUE_RANGE_MAX;
-      if (choice1 == 0) {
-        if (choice2 == 0) {
-          deque.push_back(random % DATA_VALUE_RANGE_MAX);
+    auto prefilled = [&engine, &uniform_dist, &config]() {
+      std::unique_ptr<Deque> deque(new Deque());
+      // prefill deque
+      for (unsigned long i = 0; i < config.prefill; i++) {
+        deque->push_back(uniform_dist(engine));
+      }
+      return deque;
+    };
+
+    auto phase = update_phases(config).front();
+    Workload workload = phase.second;
+    benchmark(config, phase.first,
+              {"push_back", "push_front", "pop_back", "pop_front"}, prefilled,
+              [workload](Deque& deque, uint64_t random) {
+      /* the end is drawn from the top bit, independent of the operation */
+      bool back = (random >> 63) == 0;
+      if (workload.op(random) == INSERT) {
+        if (back) {
+          deque.push_back(workload.key(random));
+          return PUSH_BACK;
         } else {
-          deque.push_front(random % DATA_VALUE_RANGE_MAX);
+          deque.push_front(workload.key(random));
+          return PUSH_FRONT;
         }
       } else {
-        if (choice2 == 0) {
+        if (back) {
           deque.pop_back();
+          return POP_BACK;
         } else {
           deque.pop_front();
+          return POP_FRONT;
         }
       }
     });
   }
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_end();
-#endif
 
 }
 
-template <typename Deque>
-void benchmark_deque_lf(Deque& deque, const Configuration& config) {
+template <typename T>
+void benchmark_deque_lf(const Configuration& config) {
   /* set up random number generator */
   std::random_device rd;
   std::mt19937 engine(rd());
-  std::uniform_int_distribution<int> uniform_dist(DATA_VALUE_RANGE_MIN,
-                                                  DATA_VALUE_RANGE_MAX);
+  std::uniform_int_distribution<long> uniform_dist(0, config.key_range - 1);
   const std::thread::id MAIN_THREAD_ID = std::this_thread::get_id();
 
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_begin();
-#endif
   {
-    auto deque_worker = std::move(deque.first);
-    auto deque_stealer = std::move(deque.second);
-    // prefill deque with 1024 elements
-    for (int i = 0; i < DATA_PREFILL; i++) {
-      // deque.push_back(uniform_dist(engine));
-      deque_worker.push(uniform_dist(engine));
-    }
-
-    benchmark(config.n_threads, config.n_ops, u8"update",
-              [&deque, &deque_worker, &deque_stealer, MAIN_THREAD_ID](int random) {
+    typedef std::pair<lockfree::deque::Worker<T>, lockfree::deque::Stealer<T>>
+        WorkStealingDeque;
+    auto prefilled = [&engine, &uniform_dist, &config]() {
+      std::unique_ptr<WorkStealingDeque> deque(
+          new WorkStealingDeque(lockfree::deque::deque<T>()));
+      // prefill deque
+      for (unsigned long i = 0; i < config.prefill; i++) {
+        deque->first.push(uniform_dist(engine));
+      }
+      return deque;
+    };
+
+    auto phase = update_phases(config).front();
+    Workload workload = phase.second;
+    benchmark(config, phase.first,
+              {"push", "pop", "steal"}, prefilled,
+              [MAIN_THREAD_ID, workload](WorkStealingDeque& deque, uint64_t random) {
+      auto& deque_worker = deque.first;
+      auto& deque_stealer = deque.second;
       if (std::this_thread::get_id() == MAIN_THREAD_ID)
       {
-        auto choice1 =
-            (random % (2 * DATA_VALUE_RANGE_MAX)) / DATA_VALUE_RANGE_MAX;
-        if (choice1 == 0) {
-          deque_worker.push(random % DATA_VALUE_RANGE_MAX);
+        if (workload.op(random) == INSERT) {
+          deque_worker.push(workload.key(random));
+          return PUSH;
         } else {
           deque_worker.pop();
+          return POP;
         }
       } else {
         auto clone = deque_stealer;
         clone.steal();
+        return STEAL;
       }
     });
   }
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_end();
-#endif
 
 }
 
 
 template <typename Stack>
-void benchmark_stack(Stack& stack, const Configuration& config) {
+void benchmark_stack(const Configuration& config) {
   /* set up random number generator */
   std::random_device rd;
   std::mt19937 engine(rd());
-  std::uniform_int_distribution<int> uniform_dist(DATA_VALUE_RANGE_MIN,
-                                                  DATA_VALUE_RANGE_MAX);
+  std::uniform_int_distribution<long> uniform_dist(0, config.key_range - 1);
 
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_begin();
-#endif
   {
-    // prefill stack with 1024 elements
-    for (int i = 0; i < DATA_PREFILL; i++) {
-      stack.push(uniform_dist(engine));
-    }
-
-    benchmark(config.n_threads, config.n_ops, u8"update", [&stack](int random) {
-      auto choice =
-          (random % (2 * DATA_VALUE_RANGE_MAX)) / DATA_VALUE_RANGE_MAX;
-      if (choice == 0) {
-        stack.push(random % DATA_VALUE_RANGE_MAX);
+    auto prefilled = [&engine, &uniform_dist, &config]() {
+      std::unique_ptr<Stack> stack(new Stack());
+      // prefill stack
+      for (unsigned long i = 0; i < config.prefill; i++) {
+        stack->push(uniform_dist(engine));
+      }
+      return stack;
+    };
+
+    auto phase = update_phases(config).front();
+    Workload workload = phase.second;
+    benchmark(config, phase.first, {"push", "pop"},
+              prefilled, [workload](Stack& stack, uint64_t random) {
+      if (workload.op(random) == INSERT) {
+        stack.push(workload.key(random));
+        return PUSH;
       } else {
         stack.pop();
+        return POP;
       }
     });
   }
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_end();
-#endif
 
 }
 
 template <typename Queue>
-void benchmark_queue(Queue& queue, const Configuration& config) {
+Queue* new_queue(const Configuration& config) {
+  return new Queue();
+}
+
+/* the bounded queues hold twice the prefill unless told otherwise */
+static size_t ring_capacity(const Configuration& config) {
+  if (config.queue_capacity) return config.queue_capacity;
+  return std::max<size_t>(2 * config.prefill, 1024);
+}
+
+template <>
+lockfree::RingQueue* new_queue<lockfree::RingQueue>(const Configuration& config) {
+  return new lockfree::RingQueue(ring_capacity(config));
+}
+
+template <>
+lockfree_mcas::RingQueue* new_queue<lockfree_mcas::RingQueue>(const Configuration& config) {
+  return new lockfree_mcas::RingQueue(ring_capacity(config));
+}
+
+/* false if a bounded queue was full */
+template <typename Queue>
+bool queue_push(Queue& queue, long value) {
+  queue.push(value);
+  return true;
+}
+
+template <typename Queue>
+bool bounded_queue() { return false; }
+
+template <>
+bool bounded_queue<lockfree::RingQueue>() { return true; }
+
+template <>
+bool bounded_queue<lockfree_mcas::RingQueue>() { return true; }
+
+template <>
+bool queue_push<lockfree::RingQueue>(lockfree::RingQueue& queue, long value) {
+  return queue.push(value);
+}
+
+template <>
+bool queue_push<lockfree_mcas::RingQueue>(lockfree_mcas::RingQueue& queue, long value) {
+  return queue.push(value);
+}
+
+template <typename Queue>
+void benchmark_queue(const Configuration& config) {
   /* set up random number generator */
   std::random_device rd;
   std::mt19937 engine(rd());
-  std::uniform_int_distribution<int> uniform_dist(DATA_VALUE_RANGE_MIN,
-                                                  DATA_VALUE_RANGE_MAX);
+  std::uniform_int_distribution<long> uniform_dist(0, config.key_range - 1);
 
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_begin();
-#endif
   {
-    // prefill queue with 1024 elements
-    for (int i = 0; i < DATA_PREFILL; i++) {
-      queue.push(uniform_dist(engine));
-    }
-
-    benchmark(config.n_threads, config.n_ops, u8"update", [&queue](int random) {
-      auto choice =
-          (random % (2 * DATA_VALUE_RANGE_MAX)) / DATA_VALUE_RANGE_MAX;
-      if (choice == 0) {
-        queue.push(random % DATA_VALUE_RANGE_MAX);
+    auto prefilled = [&engine, &uniform_dist, &config]() {
+      std::unique_ptr<Queue> queue(new_queue<Queue>(config));
+      // prefill queue
+      unsigned long filled = 0;
+      for (unsigned long i = 0; i < config.prefill; i++) {
+        filled += queue_push(*queue, uniform_dist(engine));
+      }
+      if (filled < config.prefill)
+        std::cerr << "queue full after " << filled << " of " << config.prefill
+                  << " prefill elements, raise --capacity" << std::endl;
+      return queue;
+    };
+
+    auto phase = update_phases(config).front();
+    Workload workload = phase.second;
+    /* pushes that find a bounded queue full are counted apart */
+    std::vector<std::string> ops = {"push", "pop"};
+    if (bounded_queue<Queue>()) ops.push_back("push-full");
+    benchmark(config, phase.first, ops,
+              prefilled, [workload](Queue& queue, uint64_t random) {
+      if (workload.op(random) == INSERT) {
+        return queue_push(queue, workload.key(random)) ? PUSH : PUSH_FULL;
       } else {
         queue.pop();
+        return POP;
       }
     });
   }
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_end();
-#endif
 
 }
 
-template <typename List>
-void read(List& l, int random) {
-  /* read operations: 100% read */
-  l.count(random % DATA_VALUE_RANGE_MAX);
+static uint64_t now_ns() {
+  using nanoseconds = std::chrono::nanoseconds;
+  return std::chrono::duration_cast<nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-template <typename List>
-void update(List& l, int random) {
-  /* update operations: 50% insert, 50% remove */
-  auto choice = (random % (2 * DATA_VALUE_RANGE_MAX)) / DATA_VALUE_RANGE_MAX;
-  if (choice == 0) {
-    l.insert(random % DATA_VALUE_RANGE_MAX);
-  } else {
-    l.remove(random % DATA_VALUE_RANGE_MAX);
+/* one producer streams n_ops timestamps through the queue, batch at a time,
+ * to one consumer. Unpaced, the producer runs ahead and keeps the ring full,
+ * which measures saturated throughput; paced, it sends a batch only once the
+ * consumer has taken the previous one, so the consumer's arrival time minus
+ * the stamp is the handoff latency rather than the time spent queueing
+ * behind a full ring. The main thread produces, both pin themselves like
+ * threads 0 and 1 of run_trial() */
+template <typename Queue>
+trial_result spsc_trial(const Configuration& config, const std::string& phase, Queue& queue, bool paced) {
+  const unsigned long n_items = config.n_ops;
+  const size_t batch = std::max(config.spsc_batch, 1u);
+  const unsigned int sample = config.latency_sample ? config.latency_sample : 1;
+  auto events = perf_event_specs(config);
+  std::vector<thread_stats> stats(2);
+  spin_barrier start_barrier(2);
+  std::atomic<unsigned int> running(2);
+  CACHE_ALIGNED std::atomic<unsigned long> received(0);  // published by the consumer
+
+  /* a full or empty ring is waited out spinning, then yielding, so the two
+   * sides still make progress when they share a CPU */
+  auto wait = [](unsigned int& spins) {
+    if (++spins < 1024) mcas::backoff::cpu_relax();
+    else std::this_thread::yield();
+  };
+
+  auto run = [&](unsigned int id) {
+    pin_thread(id);
+    std::vector<uint64_t> items(batch);
+    latency_histogram latency;
+    perf_counters counters(events);
+
+    start_barrier.arrive_and_wait([&]() { roi::begin(config, phase); });
+    counters.start();
+    stats[id].start = benchmark_clock::now();
+    if (id == 0) {
+      for (unsigned long sent = 0; sent < n_items;) {
+        size_t n = std::min<unsigned long>(batch, n_items - sent);
+        unsigned int spins = 0;
+        if (paced)
+          while (received.load(std::memory_order_acquire) != sent) wait(spins);
+        for (size_t done = 0; done < n;) {
+          /* stamp only once there is room, so waiting for it is not counted */
+          while (queue.room(n - done) == 0) wait(spins);
+          uint64_t stamp = now_ns();
+          for (size_t i = done; i < n; i++) items[i] = stamp;
+          done += n - done == 1 ? queue.push(items[done]) : queue.push(items.data() + done, n - done);
+        }
+        sent += n;
+      }
+    } else {
+      unsigned int countdown = sample;
+      unsigned int spins = 0;
+      for (unsigned long taken = 0; taken < n_items;) {
+        size_t n = batch == 1 ? queue.pop(items[0]) : queue.pop(items.data(), batch);
+        if (!n) {
+          wait(spins);
+          continue;
+        }
+        spins = 0;
+        uint64_t now = now_ns();
+        if (paced) {
+          for (size_t i = 0; i < n; i++) {
+            if (--countdown) continue;
+            countdown = sample;
+            latency.record(now - items[i]);
+          }
+        }
+        taken += n;
+        if (paced) received.store(taken, std::memory_order_release);
+      }
+    }
+    stats[id].stop = benchmark_clock::now();
+    counters.stop();
+    if (running.fetch_sub(1, std::memory_order_acq_rel) == 1) roi::end(config, phase);
+    stats[id].ops = n_items;
+    stats[id].latency.push_back(std::move(latency));
+    stats[id].counters = counters.read();
+  };
+
+  std::thread consumer(run, 1);
+  run(0);
+  consumer.join();
+
+  using milliseconds = std::chrono::duration<double, std::milli>;
+  trial_result result;
+  result.threads = 2;
+  result.ops = n_items;
+  result.time = milliseconds(std::max(stats[0].stop, stats[1].stop) -
+                             std::min(stats[0].start, stats[1].start)).count();
+  result.throughput = n_items / result.time / 1000;
+  for (auto& t : stats)
+    result.per_thread.push_back(t.ops / milliseconds(t.stop - t.start).count() / 1000);
+  result.calls.push_back(n_items);
+  /* only the consumer sees items arrive */
+  result.latency.push_back(std::move(stats[1].latency[0]));
+  result.counters.assign(events.size(), 0);
+  for (auto& t : stats)
+    for (size_t e = 0; e < events.size(); e++)
+      result.counters[e] = t.counters[e] < 0 || result.counters[e] < 0 ? -1 : result.counters[e] + t.counters[e];
+  return result;
+}
+
+/* saturated throughput, then one-way latency with one batch in flight */
+template <typename Queue>
+void benchmark_spsc(const Configuration& config) {
+  if (config.duration > 0)
+    std::cerr << "spsc transfers a fixed number of items (-o), --duration is ignored" << std::endl;
+
+  Configuration run_config = config;
+  run_config.n_threads = 2;
+  for (bool paced : {false, true}) {
+    const std::string phase = paced ? "spsc-latency" : "spsc-throughput";
+    double resident = resident_mib();
+    std::vector<trial_result> trials;
+    for (unsigned int i = 0; i < config.n_iter; i++) {
+      Queue queue(ring_capacity(config));
+      trials.push_back(spsc_trial(run_config, phase, queue, paced));
+    }
+    report(run_config, phase, {"one-way"}, trials);
+    report_resident(resident);
   }
 }
 
 template <typename List>
-void mixed(List& l, int random) {
-  /* mixed operations: 20% update, 80% read */
-  auto choice = (random % (10 * DATA_VALUE_RANGE_MAX)) / DATA_VALUE_RANGE_MAX;
-  if (choice == 0) {
-    l.insert(random % DATA_VALUE_RANGE_MAX);
-  } else if (choice == 1) {
-    l.remove(random % DATA_VALUE_RANGE_MAX);
-  } else {
-    l.count(random % DATA_VALUE_RANGE_MAX);
+SetOp list_op(List& l, const Workload& workload, uint64_t random) {
+  SetOp op = workload.op(random);
+  switch (op) {
+    case INSERT: l.insert(workload.key(random)); break;
+    case REMOVE: l.remove(workload.key(random)); break;
+    case LOOKUP: l.count(workload.key(random)); break;
   }
+  return op;
 }
 
 template <typename List>
-void benchmark_sorted_list(List& list1, List& list2,
-                           const Configuration& config) {
+void benchmark_sorted_list(const Configuration& config) {
   /* set up random number generator */
   std::random_device rd;
   std::mt19937 engine(rd());
-  std::uniform_int_distribution<int> uniform_dist(DATA_VALUE_RANGE_MIN,
-                                                  DATA_VALUE_RANGE_MAX);
+  std::uniform_int_distribution<long> uniform_dist(0, config.key_range - 1);
 
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_begin();
-#endif
   {
-
-    /* prefill list with 1024 elements */
-    for (int i = 0; i < DATA_PREFILL; i++) {
-      list1.insert(uniform_dist(engine));
-    }
-    benchmark(config.n_threads, config.n_ops, u8"read",
-              [&list1](int random) { read(list1, random); });
-    benchmark(config.n_threads, config.n_ops, u8"update",
-              [&list1](int random) { update(list1, random); });
-  }
-
-  {
-    /* prefill list with 1024 elements */
-    for (int i = 0; i < DATA_PREFILL; i++) {
-      list2.insert(uniform_dist(engine));
+    auto prefilled = [&engine, &uniform_dist, &config]() {
+      std::unique_ptr<List> list(new List());
+      /* prefill list */
+      for (unsigned long i = 0; i < config.prefill; i++) {
+        list->insert(uniform_dist(engine));
+      }
+      return list;
+    };
+
+    const std::vector<std::string> ops = {"insert", "remove", "count"};
+    for (auto& phase : set_phases(config)) {
+      Workload workload = phase.second;
+      benchmark(config, phase.first, ops, prefilled,
+                [workload](List& list, uint64_t random) {
+                  return list_op(list, workload, random);
+                });
     }
-    benchmark(config.n_threads, config.n_ops, u8"mixed", [&list2](int random) { mixed(list2, random); });
   }
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_end();
-#endif
-
-}
-
-template <typename HashMap>
-void hm_lookup(HashMap& map, int random) {
-  /* read operations: 100% read */
-  map.contains(random % DATA_VALUE_RANGE_MAX);
-}
 
-template <typename HashMap>
-void hm_update(HashMap& map, int random) {
-  /* update operations: 50% insert, 50% remove */
-  auto choice = (random % (2 * DATA_VALUE_RANGE_MAX)) / DATA_VALUE_RANGE_MAX;
-  if (choice == 0) {
-    map.insert_or_assign(random % DATA_VALUE_RANGE_MAX,
-                         random % DATA_VALUE_RANGE_MAX);
-  } else {
-    map.remove(random % DATA_VALUE_RANGE_MAX);
-  }
 }
 
 template <typename HashMap>
-void hm_mixed(HashMap& map, int random) {
-  /* mixed operations: 20% update, 80% read */
-  auto choice = (random % (10 * DATA_VALUE_RANGE_MAX)) / DATA_VALUE_RANGE_MAX;
-  if (choice == 0) {
-    map.insert_or_assign(random % DATA_VALUE_RANGE_MAX,
-                         random % DATA_VALUE_RANGE_MAX);
-  } else if (choice == 1) {
-    map.remove(random % DATA_VALUE_RANGE_MAX);
-  } else {
-    map.contains(random % DATA_VALUE_RANGE_MAX);
+SetOp hm_op(HashMap& map, const Workload& workload, uint64_t random) {
+  SetOp op = workload.op(random);
+  switch (op) {
+    case INSERT: {
+      long key = workload.key(random);
+      map.insert_or_assign(key, key);
+    } break;
+    case REMOVE: map.remove(workload.key(random)); break;
+    case LOOKUP: map.contains(workload.key(random)); break;
   }
+  return op;
 }
 
 template <typename HashMap>
-void benchmark_hashmap(HashMap& map1, HashMap& map2,
-                       const Configuration& config) {
+void benchmark_hashmap(const Configuration& config) {
   /* set up random number generator */
   std::random_device rd;
   std::mt19937 engine(rd());
-  std::uniform_int_distribution<int> uniform_dist(DATA_VALUE_RANGE_MIN,
-                                                  DATA_VALUE_RANGE_MAX);
-
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_begin();
-#endif
-  {
-    /* prefill list with 1024 elements */
-    for (int i = 0; i < DATA_PREFILL; i++) {
-      map1.insert_or_assign(uniform_dist(engine), uniform_dist(engine));
-    }
-    benchmark(config.n_threads, config.n_ops, u8"read",
-              [&map1](int random) { hm_lookup(map1, random); });
-    benchmark(config.n_threads, config.n_ops, u8"update",
-              [&map1](int random) { hm_update(map1, random); });
-  }
+  std::uniform_int_distribution<long> uniform_dist(0, config.key_range - 1);
 
   {
-    /* prefill list with 1024 elements */
-    for (int i = 0; i < DATA_PREFILL; i++) {
-      map2.insert_or_assign(uniform_dist(engine), uniform_dist(engine));
+    auto prefilled = [&engine, &uniform_dist, &config]() {
+      std::unique_ptr<HashMap> map(new HashMap());
+      /* prefill map */
+      for (unsigned long i = 0; i < config.prefill; i++) {
+        map->insert_or_assign(uniform_dist(engine), uniform_dist(engine));
+      }
+      return map;
+    };
+
+    const std::vector<std::string> ops = {"insert_or_assign", "remove", "contains"};
+    for (auto& phase : set_phases(config)) {
+      Workload workload = phase.second;
+      benchmark(config, phase.first, ops, prefilled,
+                [workload](HashMap& map, uint64_t random) {
+                  return hm_op(map, workload, random);
+                });
     }
-    benchmark(config.n_threads, config.n_ops, u8"mixed",
-              [&map2](int random) { hm_mixed(map2, random); });
   }
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_end();
-#endif
-
-}
 
-template <typename BST>
-void bst_lookup(BST& bst) {
-  /* read operations: 100% read */
-  bst.get_min();
 }
 
+/* the tree lookup is get_min, which walks the left spine */
 template <typename BST>
-void bst_update(BST& bst, int random) {
-  /* update operations: 50% insert, 50% remove */
-  auto choice = (random % (2 * DATA_VALUE_RANGE_MAX)) / DATA_VALUE_RANGE_MAX;
-  if (choice == 0) {
-    bst.insert(random % DATA_VALUE_RANGE_MAX);
-  } else {
-    bst.remove(random % DATA_VALUE_RANGE_MAX);
+SetOp bst_op(BST& bst, const Workload& workload, uint64_t random) {
+  SetOp op = workload.op(random);
+  switch (op) {
+    case INSERT: bst.insert(workload.key(random)); break;
+    case REMOVE: bst.remove(workload.key(random)); break;
+    case LOOKUP: bst.get_min(); break;
   }
+  return op;
 }
 
 template <typename BST>
-void bst_mixed(BST& bst, int random) {
-  /* mixed operations: 20% update, 80% read */
-  auto choice = (random % (10 * DATA_VALUE_RANGE_MAX)) / DATA_VALUE_RANGE_MAX;
-  if (choice == 0) {
-    bst.insert(random % DATA_VALUE_RANGE_MAX);
-  } else if (choice == 1) {
-    bst.remove(random % DATA_VALUE_RANGE_MAX);
-  } else {
-    bst.get_min();
-  }
-}
-
-template <typename BST>
-void benchmark_bst(BST& bst1, BST& bst2, const Configuration& config) {
+void benchmark_bst(const Configuration& config) {
   /* set up random number generator */
   std::random_device rd;
   std::mt19937 engine(rd());
-  std::uniform_int_distribution<int> uniform_dist(DATA_VALUE_RANGE_MIN,
-                                                  DATA_VALUE_RANGE_MAX);
+  std::uniform_int_distribution<long> uniform_dist(0, config.key_range - 1);
 
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_begin();
-#endif
   {
-    /* prefill list with 1024 elements */
-    for (int i = 0; i < DATA_PREFILL; i++) {
-      bst1.insert(uniform_dist(engine));
-    }
-    benchmark(config.n_threads, config.n_ops, u8"read",
-              [&bst1](int random) { bst_lookup(bst1); });
-    benchmark(config.n_threads, config.n_ops, u8"update",
-              [&bst1](int random) { bst_update(bst1, random); });
-  }
-
-  {
-    /* prefill list with 1024 elements */
-    for (int i = 0; i < DATA_PREFILL; i++) {
-      bst2.insert(uniform_dist(engine));
+    auto prefilled = [&engine, &uniform_dist, &config]() {
+      std::unique_ptr<BST> bst(new BST());
+      /* prefill tree */
+      for (unsigned long i = 0; i < config.prefill; i++) {
+        bst->insert(uniform_dist(engine));
+      }
+      return bst;
+    };
+
+    const std::vector<std::string> ops = {"insert", "remove", "get_min"};
+    for (auto& phase : set_phases(config)) {
+      Workload workload = phase.second;
+      benchmark(config, phase.first, ops, prefilled,
+                [workload](BST& bst, uint64_t random) {
+                  return bst_op(bst, workload, random);
+                });
     }
-    benchmark(config.n_threads, config.n_ops, u8"mixed",
-              [&bst2](int random) { bst_mixed(bst2, random); });
   }
-#ifdef ENABLE_PARSEC_HOOKS
-  __parsec_roi_end();
-#endif
 
 }
 
-void run_benchmarks(const Configuration& config) {
+static void run_benchmark(const Configuration& config) {
   switch (config.sync_type) {
     case Configuration::SyncType::LOCK: {
       switch (config.benchmarking_algorithm) {
         case Configuration::BenchmarkAlgorithm::MWOBJECT: {
-          std::cout << "Benchmark Locking MWObject" << std::endl;
+          console() << "Benchmark Locking MWObject" << std::endl;
           benchmark_mwobject(config);
         } break;
         case Configuration::BenchmarkAlgorithm::ARRAYSWAP: {
-          std::cout << "Benchmark Locking Array Swap" << std::endl;
+          console() << "Benchmark Locking Array Swap" << std::endl;
           benchmark_arrayswap(config);
         } break;
         case Configuration::BenchmarkAlgorithm::STACK: {
-          std::cout << "Benchmark Locking Stack" << std::endl;
-          lockbased::Stack stack;
-          benchmark_stack(stack, config);
+          console() << "Benchmark Locking Stack" << std::endl;
+          benchmark_stack<lockbased::Stack>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::QUEUE: {
-          std::cout << "Benchmark Locking Queue" << std::endl;
-          lockbased::Queue queue;
-          benchmark_queue(queue, config);
+          console() << "Benchmark Locking Queue" << std::endl;
+          benchmark_queue<lockbased::Queue>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::DEQUE: {
-          std::cout << "Benchmark Locking Deque" << std::endl;
-          lockbased::Deque deque;
-          benchmark_deque(deque, config);
+          console() << "Benchmark Locking Deque" << std::endl;
+          if (config.node_allocator == Configuration::NodeAllocator::ALLOC_POOL)
+            benchmark_deque<lockbased::Deque<alloc::pool>>(config);
+          else
+            benchmark_deque<lockbased::Deque<>>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::SORTEDLIST: {
-          std::cout << "Benchmark Locking Sorted List" << std::endl;
-          lockbased::SortedList list1;
-          lockbased::SortedList list2;
-          benchmark_sorted_list(list1, list2, config);
+          console() << "Benchmark Locking Sorted List" << std::endl;
+          if (config.node_allocator == Configuration::NodeAllocator::ALLOC_POOL)
+            benchmark_sorted_list<lockbased::SortedList<alloc::pool>>(config);
+          else
+            benchmark_sorted_list<lockbased::SortedList<>>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::HASHMAP: {
-          std::cout << "Benchmark Locking HashMap" << std::endl;
-          lockbased::HashMap map1;
-          lockbased::HashMap map2;
-          benchmark_hashmap(map1, map2, config);
+          console() << "Benchmark Locking HashMap" << std::endl;
+          if (config.node_allocator == Configuration::NodeAllocator::ALLOC_POOL)
+            benchmark_hashmap<lockbased::HashMap<alloc::pool>>(config);
+          else
+            benchmark_hashmap<lockbased::HashMap<>>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::BST: {
-          std::cout << "Benchmark Locking BST" << std::endl;
-          lockbased::BinarySearchTree bst1;
-          lockbased::BinarySearchTree bst2;
-          benchmark_bst(bst1, bst2, config);
+          console() << "Benchmark Locking BST" << std::endl;
+          benchmark_bst<lockbased::BinarySearchTree>(config);
+        } break;
+        case Configuration::BenchmarkAlgorithm::SPSC: {
+          std::cerr << "SPSC not implemented for locking" << std::endl;
         } break;
         case Configuration::ALG_UNDEF: {
           std::cerr << "ALG_UNDEF" << std::endl;
@@ -565,33 +747,32 @@ void run_benchmarks(const Configuration& config) {
           std::cerr << "ARRAYSWAP not implemented for lock-free" << std::endl;
         } break;
         case Configuration::BenchmarkAlgorithm::STACK: {
-          lockfree::Stack<int> stack;
-          benchmark_stack(stack, config);
+          console() << "Benchmark Lock-Free Stack" << std::endl;
+          benchmark_stack<lockfree::Stack<int>>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::QUEUE: {
-          lockfree::Queue queue;
-          benchmark_queue(queue, config);
+          console() << "Benchmark Lock-Free Queue" << std::endl;
+          benchmark_queue<lockfree::Queue>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::DEQUE: {
-          auto lf_spmc_deque = lockfree::deque::deque<int>();
-          benchmark_deque_lf(lf_spmc_deque, config);
+          console() << "Benchmark Lock-Free Deque" << std::endl;
+          benchmark_deque_lf<int>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::SORTEDLIST: {
-          lockfree::SortedList list1;
-          lockfree::SortedList list2;
-          benchmark_sorted_list(list1, list2, config);
+          console() << "Benchmark Lock-Free Sorted List" << std::endl;
+          benchmark_sorted_list<lockfree::SortedList>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::HASHMAP: {
-          std::cout << "Benchmark Lock-Free HashMap" << std::endl;
-          lockfree::HashMap map1;
-          lockfree::HashMap map2;
-          benchmark_hashmap(map1, map2, config);
+          console() << "Benchmark Lock-Free HashMap" << std::endl;
+          benchmark_hashmap<lockfree::HashMap>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::BST: {
-          std::cout << "Benchmark Lock-Free BST" << std::endl;
-          lockfree::BinarySearchTree bst1;
-          // lockfree::BinarySearchTree bst2;
-          benchmark_bst(bst1, bst1, config);
+          console() << "Benchmark Lock-Free BST" << std::endl;
+          benchmark_bst<lockfree::BinarySearchTree>(config);
+        } break;
+        case Configuration::BenchmarkAlgorithm::SPSC: {
+          console() << "Benchmark Lock-Free SPSC Queue" << std::endl;
+          benchmark_spsc<lockfree::SPSCQueue<uint64_t>>(config);
         } break;
         case Configuration::ALG_UNDEF: {
           std::cerr << "ALG_UNDEF" << std::endl;
@@ -601,54 +782,88 @@ void run_benchmarks(const Configuration& config) {
     case Configuration::SyncType::LOCKFREE_MCAS: {
       switch (config.benchmarking_algorithm) {
         case Configuration::BenchmarkAlgorithm::MWOBJECT: {
-          std::cout << "Benchmark Lock-Free MCAS MWObject" << std::endl;
+          console() << "Benchmark Lock-Free MCAS MWObject" << std::endl;
           benchmark_mcas_mwobject(config);
         } break;
         case Configuration::BenchmarkAlgorithm::ARRAYSWAP: {
-          std::cout << "Benchmark Lock-Free MCAS Array Swap" << std::endl;
+          console() << "Benchmark Lock-Free MCAS Array Swap" << std::endl;
           benchmark_mcas_arrayswap(config);
         } break;
         case Configuration::BenchmarkAlgorithm::STACK: {
-          std::cout << "Benchmark Lock-Free MCAS Stack" << std::endl;
-          lockfree_mcas::Stack<int> stack;
-          benchmark_stack(stack, config);
+          console() << "Benchmark Lock-Free MCAS Stack" << std::endl;
+          benchmark_stack<lockfree_mcas::Stack<int>>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::QUEUE: {
-          std::cout << "Benchmark Lock-Free MCAS Queue" << std::endl;
-          lockfree_mcas::Queue<int> queue;
-          benchmark_queue(queue, config);
+          console() << "Benchmark Lock-Free MCAS Queue" << std::endl;
+          benchmark_queue<lockfree_mcas::Queue<int>>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::DEQUE: {
-          std::cout << "Benchmark Lock-Free MCAS Deque" << std::endl;
-          lockfree_mcas::Deque deque;
-          benchmark_deque(deque, config);
+          console() << "Benchmark Lock-Free MCAS Deque" << std::endl;
+          if (config.node_allocator == Configuration::NodeAllocator::ALLOC_POOL)
+            benchmark_deque<lockfree_mcas::Deque<alloc::pool>>(config);
+          else
+            benchmark_deque<lockfree_mcas::Deque<>>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::SORTEDLIST: {
-          std::cout << "Benchmark Lock-Free MCAS Sorted List" << std::endl;
-          lockfree_mcas::SortedList list1;
-          lockfree_mcas::SortedList list2;
-          benchmark_sorted_list(list1, list2, config);
+          console() << "Benchmark Lock-Free MCAS Sorted List" << std::endl;
+          if (config.node_allocator == Configuration::NodeAllocator::ALLOC_POOL)
+            benchmark_sorted_list<lockfree_mcas::SortedList<alloc::pool>>(config);
+          else
+            benchmark_sorted_list<lockfree_mcas::SortedList<>>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::HASHMAP: {
-          std::cout << "Benchmark Lock-Free MCAS HashMap" << std::endl;
-          lockfree_mcas::HashMap map1;
-          lockfree_mcas::HashMap map2;
-          benchmark_hashmap(map1, map2, config);
+          console() << "Benchmark Lock-Free MCAS HashMap" << std::endl;
+          benchmark_hashmap<lockfree_mcas::HashMap>(config);
         } break;
         case Configuration::BenchmarkAlgorithm::BST: {
-          std::cout << "Benchmark Lock-Free MCAS BST" << std::endl;
-          lockfree_mcas::BinarySearchTree bst1;
-          lockfree_mcas::BinarySearchTree bst2;
-          benchmark_bst(bst1, bst2, config);
+          console() << "Benchmark Lock-Free MCAS BST" << std::endl;
+          benchmark_bst<lockfree_mcas::BinarySearchTree>(config);
+        } break;
+        case Configuration::BenchmarkAlgorithm::SPSC: {
+          std::cerr << "SPSC not implemented for lock-free MCAS" << std::endl;
         } break;
         case Configuration::ALG_UNDEF: {
           std::cerr << "ALG_UNDEF" << std::endl;
         } break;
       }
     } break;
+    case Configuration::SyncType::LOCKFREE_RING: {
+      if (config.benchmarking_algorithm != Configuration::BenchmarkAlgorithm::QUEUE) {
+        std::cerr << "lockfree-ring only implements a queue" << std::endl;
+        break;
+      }
+      console() << "Benchmark Lock-Free Ring Queue" << std::endl;
+      benchmark_queue<lockfree::RingQueue>(config);
+    } break;
+    case Configuration::SyncType::LOCKFREE_MCAS_RING: {
+      if (config.benchmarking_algorithm != Configuration::BenchmarkAlgorithm::QUEUE) {
+        std::cerr << "lockfree-mcas-ring only implements a queue" << std::endl;
+        break;
+      }
+      console() << "Benchmark Lock-Free MCAS Ring Queue" << std::endl;
+      benchmark_queue<lockfree_mcas::RingQueue>(config);
+    } break;
+    case Configuration::SyncType::LOCKFREE_FAA: {
+      if (config.benchmarking_algorithm != Configuration::BenchmarkAlgorithm::QUEUE) {
+        std::cerr << "lockfree-faa only implements a queue" << std::endl;
+        break;
+      }
+      console() << "Benchmark Lock-Free FAA Queue" << std::endl;
+      benchmark_queue<lockfree::FAAQueue>(config);
+    } break;
     case Configuration::SYNC_UNDEF: {
       std::cerr << "SYNC_UNDEF" << std::endl;
     } break;
   }
 
 }
+
+void run_benchmarks(const Configuration& config) {
+  for (auto sync_type : config.sync_types) {
+    Configuration run_config = config;
+    run_config.sync_type = sync_type;
+    run_benchmark(run_config);
+  }
+
+  if (!config.thread_sweep.empty()) scaling_table::instance().print(console(), config);
+}
@@ -1,12 +1,20 @@
 #pragma once
 
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
 class Configuration{
 public:
   enum SyncType{
     SYNC_UNDEF,
     LOCK,
     LOCKFREE,
-    LOCKFREE_MCAS
+    LOCKFREE_MCAS,
+    LOCKFREE_RING,      // bounded array queues, queue only
+    LOCKFREE_MCAS_RING,
+    LOCKFREE_FAA        // fetch-and-add array queue, queue only
   };
 
   enum BenchmarkAlgorithm{
@@ -19,6 +27,62 @@ public:
     SORTEDLIST,
     HASHMAP,
     BST,
+    SPSC,  // one producer, one consumer
+  };
+
+  enum MWObjectSpread{
+    PACKED,
+    LINE,
+    PAGE
+  };
+
+  enum OutputFormat{
+    TEXT,
+    JSON,
+    CSV
+  };
+
+  enum KeyDistribution{
+    UNIFORM,
+    ZIPF,
+    HOTSPOT,
+    SEQUENTIAL
+  };
+
+  /* contention management after a failed MCAS or CAS */
+  enum BackoffPolicy{
+    BACKOFF_NONE,
+    BACKOFF_EXPONENTIAL,
+    BACKOFF_ADAPTIVE
+  };
+
+  /* how the classic lock-free structures free unlinked nodes */
+  enum ReclaimScheme{
+    RECLAIM_NONE,
+    RECLAIM_EPOCH,
+    RECLAIM_HAZARD
+  };
+
+  /* where the linked structures get their nodes from */
+  enum NodeAllocator{
+    ALLOC_HEAP,
+    ALLOC_POOL
+  };
+
+  /* what marks the region of interest of a phase */
+  enum RoiBackend{
+    ROI_NONE,
+    ROI_PARSEC,  // __parsec_roi_begin/end, gem5 m5 ops
+    ROI_PERF,    // perf stat --control fd
+    ROI_TRACE    // timestamps on stderr
+  };
+
+  /* relative weights of insert, remove and lookup operations */
+  struct OpMix{
+    unsigned int insert;
+    unsigned int remove;
+    unsigned int lookup;
+    unsigned int total() const { return insert + remove + lookup; }
   };
 
   Configuration(){
@@ -27,14 +91,75 @@ public:
     benchmarking_algorithm = ALG_UNDEF;
     n_iter = 1;
     n_ops = 100;
+    key_range = 256;
+    prefill = 1024;
+    queue_capacity = 0;
+    spsc_batch = 1;
+    mix = {0, 0, 0};
+    key_dist = UNIFORM;
+    zipf_theta = 0.99;
+    hotspot_ops = 0.9;
+    hotspot_keys = 0.1;
+    mwobject_width = 4;
+    mwobject_spread = PACKED;
+    pregenerate = false;
+    duration = 0;
+    warmup = 0;
+    latency_sample = 0;
+    output_format = TEXT;
+    perf_counters = false;
+    heatmap_sample = 0;
+    backoff = BACKOFF_NONE;
+    backoff_min = 16;
+    backoff_max = 4096;
+    backoff_pause = false;
+    reclaim = RECLAIM_EPOCH;
+    node_allocator = ALLOC_HEAP;
+    heatmap_top = 10;
+#ifdef ENABLE_PARSEC_HOOKS
+    roi_backend = ROI_PARSEC;
+#else
+    roi_backend = ROI_NONE;
+#endif
     debug = false;
   };
 
   SyncType sync_type;
+  std::vector<SyncType> sync_types;  // run one after another, sync_type is the current one
   BenchmarkAlgorithm benchmarking_algorithm;
   unsigned int n_threads;
+  std::vector<unsigned int> thread_sweep;  // thread counts to run instead of n_threads
   unsigned int n_iter;
   unsigned int n_ops;
+  unsigned long key_range;
+  unsigned long prefill;
+  unsigned long queue_capacity;  // slots of the bounded queues, 0 sizes them from prefill
+  unsigned int spsc_batch;       // items the spsc producer and consumer move per call
+  OpMix mix;  // all zero runs the standard read/update/mixed phases
+  KeyDistribution key_dist;
+  double zipf_theta;
+  double hotspot_ops;   // fraction of operations that go to the hot keys
+  double hotspot_keys;  // fraction of the keys that are hot
+  unsigned int mwobject_width;
+  MWObjectSpread mwobject_spread;
+  bool pregenerate;
+  double duration;  // seconds, 0 runs a fixed number of operations
+  double warmup;    // seconds
+  unsigned int latency_sample;  // time every nth operation, 0 disables
+  OutputFormat output_format;
+  std::string output_file;      // empty writes to stdout
+  bool perf_counters;
+  std::vector<std::pair<std::string, uint64_t>> perf_raw_events;  // name, raw event code
+  unsigned int heatmap_sample;  // sample every nth failed MCAS, 0 disables
+  unsigned int heatmap_top;     // hot words and lines to print
+  BackoffPolicy backoff;
+  unsigned int backoff_min;  // spins
+  unsigned int backoff_max;
+  bool backoff_pause;        // spin on PAUSE instead of a compiler barrier
+  ReclaimScheme reclaim;
+  NodeAllocator node_allocator;
+  RoiBackend roi_backend;
+  std::vector<std::string> roi_phases;  // empty selects every measured phase, prefill excluded
   bool debug;
   static const Configuration default_conf;
 };
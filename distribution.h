@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "configuration.h"
+
+/* splitmix64 finalizer: a second, independent-looking draw from one
+ * random number */
+inline uint64_t remix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/* maps a uniform 64-bit random number to a key in [0, n) following
+ * --dist. Skewed distributions are precomputed into an alias table, so a
+ * draw is one multiply, one table load and one compare whatever the skew;
+ * hot keys are scattered over the key range by a random permutation so
+ * they do not all sit at the front of a sorted list or in one bucket */
+class key_distribution {
+ public:
+  key_distribution(const Configuration& config, unsigned long n)
+      : kind(config.key_dist), n(n) {
+    switch (kind) {
+      case Configuration::KeyDistribution::ZIPF: {
+        std::vector<double> weights(n);
+        for (unsigned long rank = 0; rank < n; rank++)
+          weights[rank] = 1.0 / std::pow(rank + 1, config.zipf_theta);
+        build(weights);
+      } break;
+      case Configuration::KeyDistribution::HOTSPOT: {
+        unsigned long hot = std::max(1ul, std::min(n, static_cast<unsigned long>(config.hotspot_keys * n)));
+        double hot_weight = config.hotspot_ops / hot;
+        double cold_weight = hot < n ? (1 - config.hotspot_ops) / (n - hot) : 0;
+        std::vector<double> weights(n);
+        for (unsigned long rank = 0; rank < n; rank++)
+          weights[rank] = rank < hot ? hot_weight : cold_weight;
+        build(weights);
+      } break;
+      default:
+        break;
+    }
+  }
+
+  long operator()(uint64_t random) const {
+    switch (kind) {
+      case Configuration::KeyDistribution::SEQUENTIAL:
+        /* the low half counts the thread's operations (sequential_keys) */
+        return (random & 0xffffffff) % n;
+      case Configuration::KeyDistribution::ZIPF:
+      case Configuration::KeyDistribution::HOTSPOT: {
+        uint64_t h = remix(random);
+        uint64_t slot = ((h & 0xffffffff) * n) >> 32;
+        return (h >> 32) < threshold[slot] ? slot : alias[slot];
+      }
+      default:
+        return random % n;
+    }
+  }
+
+ private:
+  /* Vose's alias method over weights indexed by rank; rank r becomes key
+   * permutation[r] */
+  void build(const std::vector<double>& weights) {
+    std::vector<uint32_t> permutation(n);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::mt19937_64 engine(std::random_device{}());
+    std::shuffle(permutation.begin(), permutation.end(), engine);
+
+    double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+    std::vector<double> scaled(n);
+    for (unsigned long rank = 0; rank < n; rank++)
+      scaled[permutation[rank]] = weights[rank] * n / sum;
+
+    threshold.assign(n, 0);
+    alias.resize(n);
+    std::vector<uint32_t> small, large;
+    for (unsigned long key = 0; key < n; key++)
+      (scaled[key] < 1 ? small : large).push_back(key);
+    while (!small.empty() && !large.empty()) {
+      uint32_t s = small.back(), l = large.back();
+      small.pop_back();
+      threshold[s] = static_cast<uint32_t>(scaled[s] * 4294967296.0);
+      alias[s] = l;
+      scaled[l] -= 1 - scaled[s];
+      if (scaled[l] < 1) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    /* what is left has probability one up to rounding: alias to itself */
+    for (uint32_t key : small) alias[key] = key;
+    for (uint32_t key : large) alias[key] = key;
+  }
+
+  Configuration::KeyDistribution kind;
+  unsigned long n;
+  std::vector<uint32_t> threshold;  // P(keep slot) scaled to 2^32
+  std::vector<uint32_t> alias;
+};
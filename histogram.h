@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+/* HDR-style log-linear histogram of latencies in nanoseconds: every power
+ * of two is split into 2^SUB_BITS linear buckets, which bounds the relative
+ * error of a recorded value by 2^-SUB_BITS (about 3%) over the full range */
+class latency_histogram {
+ public:
+  static const int SUB_BITS = 5;
+  static const int SUB_BUCKETS = 1 << SUB_BITS;
+  static const int NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+  latency_histogram() : counts(NUM_BUCKETS), total(0), highest(0) {}
+
+  void record(uint64_t ns) {
+    counts[bucket_of(ns)]++;
+    total++;
+    if (ns > highest) highest = ns;
+  }
+
+  void merge(const latency_histogram& other) {
+    for (int i = 0; i < NUM_BUCKETS; i++) counts[i] += other.counts[i];
+    total += other.total;
+    if (other.highest > highest) highest = other.highest;
+  }
+
+  uint64_t count() const { return total; }
+  uint64_t max() const { return highest; }
+
+  /* smallest recorded value v such that a fraction q of all samples is <= v,
+   * up to the bucket resolution */
+  uint64_t percentile(double q) const {
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * total + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+      seen += counts[i];
+      if (seen >= rank) {
+        uint64_t upper = highest_in(i);
+        return upper < highest ? upper : highest;
+      }
+    }
+    return highest;
+  }
+
+ private:
+  static int bucket_of(uint64_t ns) {
+    if (ns < SUB_BUCKETS) return static_cast<int>(ns);
+    int shift = 63 - __builtin_clzll(ns) - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS +
+           static_cast<int>((ns >> shift) - SUB_BUCKETS);
+  }
+
+  static uint64_t highest_in(int bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    int shift = bucket / SUB_BUCKETS - 1;
+    uint64_t lowest = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lowest + (1ull << shift) - 1;
+  }
+
+  std::vector<uint64_t> counts;
+  uint64_t total;
+  uint64_t highest;
+};
@@ -3,9 +3,12 @@
 #include <memory>
 #include <mutex>
 
+#include "../alloc/pool.h"
+
 namespace lockbased {
 
 
+template <template <typename> class Allocator = alloc::heap>
 class Deque {
  private:
   struct Node {
@@ -14,6 +17,7 @@ class Deque {
     Node *next;
     Node() = default;
   };
+  typedef Allocator<Node> node_alloc;
 
   Node *head;
   Node *tail;
@@ -21,8 +25,8 @@ class Deque {
 
  public:
   Deque() {
-    head = new Node();
-    tail = new Node();
+    head = node_alloc::allocate();
+    tail = node_alloc::allocate();
 
     head->next = tail;
     tail->prev = head;
@@ -33,14 +37,14 @@ class Deque {
     while (curr != tail) {
       Node *tmp = curr;
       curr = curr->next;
-      delete tmp;
+      node_alloc::free(tmp);
     }
-    delete tail;
+    node_alloc::free(tail);
   }
 
   // push_left
   void push_front(int const& data) {
-    Node *new_node = new Node();
+    Node *new_node = node_alloc::allocate();
     new_node->data = data;
     {
       std::lock_guard<std::mutex> lock(deque_lock);
@@ -55,7 +59,7 @@ class Deque {
 
   // push_right
   void push_back(int const& data) {
-    Node *new_node = new Node();
+    Node *new_node = node_alloc::allocate();
     new_node->data = data;
     {
       std::lock_guard<std::mutex> lock(deque_lock);
@@ -79,10 +83,11 @@ class Deque {
 	data = head->next->data;
 	tmp = head->next;
 	head->next = head->next->next;
+	head->next->prev = head;
 	found = true;
       }
     }
-    if (found) delete tmp;
+    if (found) node_alloc::free(tmp);
     return data;
   }
 
@@ -97,10 +102,11 @@ class Deque {
 	data = tail->prev->data;
 	tmp = tail->prev;
 	tail->prev = tail->prev->prev;
+	tail->prev->next = tail;
 	found = true;
       }
     }
-    if (found) delete tmp;
+    if (found) node_alloc::free(tmp);
     return data;
   }
 };
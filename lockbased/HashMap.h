@@ -3,10 +3,13 @@
 #include <memory>
 #include <mutex>
 
+#include "../alloc/pool.h"
+
 #define TABLE_SIZE 10000
 
 namespace lockbased {
 
+template <template <typename> class Allocator = alloc::heap>
 class HashMap {
  private:
   struct Node {
@@ -16,6 +19,7 @@ class HashMap {
     Node *prev;
     Node() = default;
   };
+  typedef Allocator<Node> node_alloc;
 
   Node *bucket_heads[TABLE_SIZE];
   Node *bucket_tails[TABLE_SIZE];
@@ -24,8 +28,8 @@ class HashMap {
  public:
   HashMap() {
     for (int i = 0; i < TABLE_SIZE; i++) {
-      bucket_heads[i] = new Node();
-      bucket_tails[i] = new Node();
+      bucket_heads[i] = node_alloc::allocate();
+      bucket_tails[i] = node_alloc::allocate();
       bucket_heads[i]->next = bucket_tails[i];
       bucket_tails[i]->prev = bucket_heads[i];
     }
@@ -40,12 +44,12 @@ class HashMap {
       while (curr != tail) {
         Node *tmp = curr;
         curr = curr->next;
-        delete tmp;
+        node_alloc::free(tmp);
       }
 
 
-      delete bucket_tails[i];
-      delete bucket_heads[i];
+      node_alloc::free(bucket_tails[i]);
+      node_alloc::free(bucket_heads[i]);
     }
   }
 
@@ -63,7 +67,7 @@ class HashMap {
     }
 
     if (curr == tail) {
-      Node* new_node = new Node();
+      Node* new_node = node_alloc::allocate();
       new_node->key = key;
       new_node->value = value;
 
@@ -113,7 +117,7 @@ class HashMap {
       curr->next->prev = curr->prev;
       curr->prev->next = curr->next;
     }
-    delete tmp;
+    node_alloc::free(tmp);
 
     return;
   }
@@ -5,10 +5,10 @@
 namespace lockbased {
 
 
-class Queue : Deque {
+class Queue : Deque<> {
  public:
-  void push(int const& data) { return Deque::push_back(data); }
-  int pop() { return Deque::pop_front(); }
+  void push(int const& data) { return Deque<>::push_back(data); }
+  int pop() { return Deque<>::pop_front(); }
 };
 
 }  // namespace lockbased
@@ -3,9 +3,12 @@
 #include <memory>
 #include <mutex>
 
+#include "../alloc/pool.h"
+
 namespace lockbased {
 
 
+template <template <typename> class Allocator = alloc::heap>
 class SortedList {
  private:
   struct Node {
@@ -14,6 +17,7 @@ class SortedList {
     Node *prev;
     Node() = default;
   };
+  typedef Allocator<Node> node_alloc;
 
   Node *head;
   Node *tail;
@@ -21,8 +25,8 @@ class SortedList {
 
  public:
   SortedList() {
-    head = new Node();
-    tail = new Node();
+    head = node_alloc::allocate();
+    tail = node_alloc::allocate();
     head->next = tail;
     tail->prev = head;
   }
@@ -33,13 +37,13 @@ class SortedList {
       while (curr != tail) {
         Node *tmp = curr;
         curr = curr->next;
-        delete tmp;
+        node_alloc::free(tmp);
       }
-      delete tail;
+      node_alloc::free(tail);
   }
 
   void insert(int const& data) {
-    Node *new_node = new Node();
+    Node *new_node = node_alloc::allocate();
     new_node->data = data;
     {
       std::lock_guard<std::mutex> lock(list_lock);
@@ -78,7 +82,7 @@ class SortedList {
       curr->next->prev = curr->prev;
       curr->prev->next = curr->next;
     }
-    delete tmp;
+    node_alloc::free(tmp);
 
     return;
   }
@@ -5,10 +5,10 @@
 namespace lockbased {
 
 
-class Stack : Deque {
+class Stack : Deque<> {
  public:
-  void push(int const& data) { return Deque::push_front(data); }
-  int pop() { return Deque::pop_front(); }
+  void push(int const& data) { return Deque<>::push_front(data); }
+  int pop() { return Deque<>::pop_front(); }
 };
 
 }  // namespace lockbased
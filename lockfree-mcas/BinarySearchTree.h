@@ -5,7 +5,9 @@
 
 #include <climits>
 #include <memory>
+#include <vector>
 #include "../mcas/mcas.h"
+#include "../reclaim/epoch.h"
 
 namespace lockfree_mcas {
 
@@ -28,215 +30,101 @@ class BinarySearchTree {
   } node_type;
 
  public:
-  BinarySearchTree() : root(nullptr) {};
+  BinarySearchTree() : root(nullptr) {
+    mcas::stats::label(this, &root, sizeof(root), "BinarySearchTree::root");
+  };
+
+  ~BinarySearchTree() {
+    mcas::stats::forget(this);
+    std::vector<Node*> pending;
+    if (root) pending.push_back(root);
+    while (!pending.empty()) {
+      Node *node = pending.back();
+      pending.pop_back();
+      if (node->left) pending.push_back(node->left);
+      if (node->right) pending.push_back(node->right);
+      delete node;
+    }
+  }
 
   void insert(const int value) {
     Node *new_node = new Node();
     new_node->value = value;
 
-    if (!root) {
-      {
-        Node *temp = nullptr;
-        // std::lock_guard<std::mutex> lock(cas_lock);
-        if (cas(reinterpret_cast<uint64_t *>(&root),
-                reinterpret_cast<uint64_t>(temp),
-                reinterpret_cast<uint64_t>(new_node)))
-          return;
-      }
-    }
-
+    reclaim::epoch::guard guard;
     while (true) {
-      Node *curr = root;
+      retry:
+      Node *curr = mcas_read(&root);
       Node *prev = nullptr;
       node_type type = LEFT;
 
       while (curr) {
         prev = curr;
         if (value < curr->value) {
-          curr = curr->left;
+          curr = mcas_read(&curr->left);
           type = LEFT;
         } else {
-          curr = curr->right;
+          curr = mcas_read(&curr->right);
           type = RIGHT;
         }
+        if (curr == prev) goto retry;  // stepped onto a removed node
       }
-      if (type == LEFT) {
-        auto last = prev->left;
-        {
-          // std::lock_guard<std::mutex> lock(cas_lock);
-          if (cas(reinterpret_cast<uint64_t *>(&prev->left),
-                  reinterpret_cast<uint64_t>(last),
-                  reinterpret_cast<uint64_t>(new_node)))
-            return;
-        }
-      } else {
-        auto last = prev->right;
-        {
-          // std::lock_guard<std::mutex> lock(cas_lock);
-          if (cas(reinterpret_cast<uint64_t *>(&prev->right),
-                  reinterpret_cast<uint64_t>(last),
-                  reinterpret_cast<uint64_t>(new_node)))
-            return;
-        }
-      }
+      // only ever fill an empty link, never replace a subtree that was
+      // attached in the meantime or the self-link of a removed node
+      Node **link = !prev ? &root : type == LEFT ? &prev->left : &prev->right;
+      if (kcas<1>({{link, nullptr, new_node}}))
+        return;
     }
   }
 
   void remove(int value) {
+    reclaim::epoch::guard guard;
     retry:
-    Node *curr = root;
+    Node *curr = mcas_read(&root);
     Node *prev = nullptr;
     node_type type = LEFT;
     while (curr) {
       if (curr->value == value) {
-        if (!curr->left && !curr->right) {  // node to be removed has no children’s
-          if (curr != root && prev) {      // delete leaf node
-            if (type == LEFT) {
-              while (true) {
-                // Node *last = prev;
-                Node *present = curr;
-                Node *temp = nullptr;
-                {
-                  if (dcas(reinterpret_cast<uint64_t *>(&curr),
-                           reinterpret_cast<uint64_t>(present),
-                           reinterpret_cast<uint64_t>(temp),
-                           reinterpret_cast<uint64_t *>(&prev->left),
-                           reinterpret_cast<uint64_t>(present),
-                           reinterpret_cast<uint64_t>(temp)
-                           )) return;
-                }
-                goto retry;
-              }
-            } else {
-              while (true) {
-                // Node *last = prev;
-                Node *present = curr;
-                Node *temp = nullptr;
-                {
-                  if (dcas(reinterpret_cast<uint64_t *>(&curr),
-                           reinterpret_cast<uint64_t>(present),
-                           reinterpret_cast<uint64_t>(temp),
-                           reinterpret_cast<uint64_t *>(&prev->right),
-                           reinterpret_cast<uint64_t>(present),
-                           reinterpret_cast<uint64_t>(temp)))
-                    return;
-                }
-                goto retry;
-              }
-            }
-          } else {
-            Node *last = root;
-            Node *temp = nullptr;
-            //auto temp = dummy->left;
-            {
-              if (cas(reinterpret_cast<uint64_t *>(&root),
-                      reinterpret_cast<uint64_t>(last),
-                      reinterpret_cast<uint64_t>(temp)))
-                return;
-            }
-          }  // deleted node is root
-        } else if (curr->left &&
-                   curr->right) {  // node to be removed has two children’s
-          curr->value = get_min(curr->right);  // find minimum value from right subtree
+        Node *left = mcas_read(&curr->left);
+        Node *right = mcas_read(&curr->right);
+        if (left == curr || right == curr) goto retry;
+        if (left && right) {  // node to be removed has two children’s
+          curr->value = get_min(right);  // find minimum value from right subtree
           value = curr->value;
           prev = curr;
-          curr = curr->right;  // continue from right subtree delete min node
+          curr = right;  // continue from right subtree delete min node
           type = RIGHT;
           continue;
-        } else {              // node to be removed has one children
-          if (curr == root) {  // root with one child
-            if (root->left) {
-              auto last = root;
-              auto temp = root->left;
-              {
-                if (cas(reinterpret_cast<uint64_t *>(&root),
-                        reinterpret_cast<uint64_t>(last),
-                        reinterpret_cast<uint64_t>(temp)))
-                  return;
-              }
-            } else {
-              auto last = root;
-              auto temp = root->right;
-              {
-                if (cas(reinterpret_cast<uint64_t *>(&root),
-                        reinterpret_cast<uint64_t>(last),
-                        reinterpret_cast<uint64_t>(temp)))
-                  return;
-              }
-            }
-          } else {  // subtree with one child
-            if (type == LEFT) {
-              if (curr->left) {
-                while (true) {
-                  Node *present = curr;
-                  Node *temp = nullptr;
-                  {
-                    if (dcas(reinterpret_cast<uint64_t *>(&prev->left),
-                             reinterpret_cast<uint64_t>(present),
-                             reinterpret_cast<uint64_t>(present->left),
-                             reinterpret_cast<uint64_t *>(&curr),
-                             reinterpret_cast<uint64_t>(present),
-                             reinterpret_cast<uint64_t>(temp)))
-                      return;
-                  }
-                  goto retry;
-                }
-              } else {
-                Node *present = curr;
-                Node *temp = nullptr;
-                {
-                  if (dcas(reinterpret_cast<uint64_t *>(&prev->right),
-                           reinterpret_cast<uint64_t>(present),
-                           reinterpret_cast<uint64_t>(present->right),
-                           reinterpret_cast<uint64_t *>(&curr),
-                           reinterpret_cast<uint64_t>(present),
-                           reinterpret_cast<uint64_t>(temp))) return;
-                }
-              }
-            } else {
-              if (curr->left) {
-                Node *last = curr->left;
-                Node *present = curr;
-                Node *temp = nullptr;
-                {
-                  if (dcas(reinterpret_cast<uint64_t *>(&prev->left),
-                           reinterpret_cast<uint64_t>(present),
-                           reinterpret_cast<uint64_t>(last),
-                           reinterpret_cast<uint64_t *>(&curr),
-                           reinterpret_cast<uint64_t>(present),
-                           reinterpret_cast<uint64_t>(temp))) return;
-                }
-              } else {
-                Node *last = curr->right;
-                Node *present = curr;
-                Node *temp = nullptr;
-                {
-                  if(dcas(reinterpret_cast<uint64_t *>(&prev->right),
-                          reinterpret_cast<uint64_t>(present),
-                          reinterpret_cast<uint64_t>(last),
-                          reinterpret_cast<uint64_t *>(&curr),
-                          reinterpret_cast<uint64_t>(present),
-                          reinterpret_cast<uint64_t>(temp)))
-                    return;
-                }
-              }
-            }
-          }
         }
+        // no or one child: the parent link (or root) swings to the child.
+        // The removed node links to itself in the same MCAS, so an operation
+        // still standing on it can neither unlink the child again from under
+        // its new parent nor attach a node that nobody would ever reach
+        Node **link = !prev ? &root : type == LEFT ? &prev->left : &prev->right;
+        Node *child = left ? left : right;
+        if (kcas<3>({{link, curr, child},
+                     {&curr->left, left, curr},
+                     {&curr->right, right, curr}})) {
+          reclaim::epoch::retire(curr);
+          return;
+        }
+        goto retry;
       }
       prev = curr;
       if (value < curr->value) {
-        curr = curr->left;
+        curr = mcas_read(&curr->left);
         type = LEFT;
       } else {
-        curr = curr->right;
+        curr = mcas_read(&curr->right);
         type = RIGHT;
       }
+      if (curr == prev) goto retry;
     }
   }
 
   int get_min() {
-    return get_min(root);
+    reclaim::epoch::guard guard;
+    return get_min(mcas_read(&root));
   }
 
   int get_min(Node *_root) {
@@ -245,28 +133,23 @@ class BinarySearchTree {
 
     while (curr) {
       if (curr->value < min) min = curr->value;
-      if (curr->left) {
-        curr = curr->left;
-      } else if (curr->right) {
-        curr = curr->right;
-      } else
-        curr = nullptr;
+      Node *left = mcas_read(&curr->left);
+      Node *next = left ? left : mcas_read(&curr->right);
+      curr = next == curr ? nullptr : next;  // a removed node links to itself
     }
     return min;
   }
 
   int get_max() {
-    auto curr = root;
-    auto max = root ? root->value : sentinel_min;
+    reclaim::epoch::guard guard;
+    auto curr = mcas_read(&root);
+    auto max = curr ? curr->value : sentinel_min;
 
     while (curr) {
       if (curr->value > max) max = curr->value;
-      if (curr->right) {
-        curr = curr->right;
-      } else if (curr->left) {
-        curr = curr->left;
-      } else
-        curr = nullptr;
+      Node *right = mcas_read(&curr->right);
+      Node *next = right ? right : mcas_read(&curr->left);
+      curr = next == curr ? nullptr : next;  // a removed node links to itself
     }
     return max;
   }
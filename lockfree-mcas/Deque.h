@@ -6,10 +6,14 @@
 
 #pragma once
 
+#include "../alloc/pool.h"
 #include "../mcas/mcas.h"
+#include "../padding.h"
+#include "../reclaim/epoch.h"
 
 namespace lockfree_mcas {
 
+template <template <typename> class Allocator = alloc::heap>
 class Deque {
  private:
   struct Node {
@@ -18,86 +22,120 @@ class Deque {
     Node *R;
     Node() = default;
   };
+  typedef Allocator<Node> node_alloc;
 
-  Node *LeftHat;   // head
-  Node *RightHat;  // tail
-  Node *dummy;
+  CACHE_ALIGNED Node *LeftHat;   // head
+  CACHE_ALIGNED Node *RightHat;  // tail
+  CACHE_ALIGNED Node *dummy;
+
+  // A popped node is self-linked but stays referenced: by the inner
+  // neighbour's outer link, or by a hat once the deque ran empty. It is
+  // retired by the operation that overwrites that last reference.
+  void retire_dead(Node *node) {
+    if (node != dummy) reclaim::epoch::retire(node, node_alloc::free);
+  }
 
  public:
   Deque() {
-    dummy = new Node();
+    dummy = node_alloc::allocate();
     dummy->L = dummy;
     dummy->R = dummy;
     LeftHat = dummy;
     RightHat = dummy;
+    mcas::stats::label(this, &LeftHat, sizeof(LeftHat), "Deque::LeftHat");
+    mcas::stats::label(this, &RightHat, sizeof(RightHat), "Deque::RightHat");
+    mcas::stats::label(this, &dummy->L, sizeof(dummy->L), "Deque::dummy", -1, "->L");
+    mcas::stats::label(this, &dummy->R, sizeof(dummy->R), "Deque::dummy", -1, "->R");
   }
 
   ~Deque() {
+    mcas::stats::forget(this);
     while (true) {
       int val = pop_back();
       if (val == -1) break;
     }
-    delete dummy;
+    if (LeftHat != dummy) node_alloc::free(LeftHat);
+    if (RightHat != dummy && RightHat != LeftHat) node_alloc::free(RightHat);
+    node_alloc::free(dummy);
   }
 
   // push_left
   void push_front(int const& data) {
-    Node *new_node = new Node();
+    Node *new_node = node_alloc::allocate();
     new_node->L = dummy;
     new_node->data = data;
 
+    reclaim::epoch::guard guard;
     while (true) {
-      Node* lh = LeftHat;
-      Node* lhL = lh->L;
+      Node* lh = mcas_read(&LeftHat);
+      Node* lhL = mcas_read(&lh->L);
       if (lhL == lh) {
         new_node->R = dummy;
-        Node* rh = RightHat;
-        if (dcas(reinterpret_cast<uint64_t *>(&LeftHat), reinterpret_cast<uint64_t>(lh), reinterpret_cast<uint64_t>(new_node),
-                 reinterpret_cast<uint64_t *>(&RightHat), reinterpret_cast<uint64_t>(rh), reinterpret_cast<uint64_t>(new_node))) return;
+        Node* rh = mcas_read(&RightHat);
+        if (kcas<2>({{&LeftHat, lh, new_node},
+                     {&RightHat, rh, new_node}})) {
+          // the deque was empty, the hats sat on dead nodes or the dummy
+          retire_dead(lh);
+          if (rh != lh) retire_dead(rh);
+          return;
+        }
       } else {
         new_node->R = lh;
-        if (dcas(reinterpret_cast<uint64_t *>(&LeftHat), reinterpret_cast<uint64_t>(lh), reinterpret_cast<uint64_t>(new_node),
-                 reinterpret_cast<uint64_t *>(&lh->L), reinterpret_cast<uint64_t>(lhL), reinterpret_cast<uint64_t>(new_node))) return;
+        if (kcas<2>({{&LeftHat, lh, new_node},
+                     {&lh->L, lhL, new_node}})) {
+          retire_dead(lhL);
+          return;
+        }
       }
     }
   }
 
   // push_right
   void push_back(int const& data) {
-    Node *new_node = new Node();
+    Node *new_node = node_alloc::allocate();
     new_node->R = dummy;
     new_node->data = data;
 
+    reclaim::epoch::guard guard;
     while (true) {
-      Node* rh = RightHat;
-      Node* rhR = rh->R;
+      Node* rh = mcas_read(&RightHat);
+      Node* rhR = mcas_read(&rh->R);
       if (rhR == rh) {
         new_node->L = dummy;
-        Node* lh = LeftHat;
-        if (dcas(reinterpret_cast<uint64_t *>(&RightHat), reinterpret_cast<uint64_t>(rh), reinterpret_cast<uint64_t>(new_node),
-                 reinterpret_cast<uint64_t *>(&LeftHat), reinterpret_cast<uint64_t>(lh), reinterpret_cast<uint64_t>(new_node))) return;
+        Node* lh = mcas_read(&LeftHat);
+        if (kcas<2>({{&RightHat, rh, new_node},
+                     {&LeftHat, lh, new_node}})) {
+          retire_dead(rh);
+          if (lh != rh) retire_dead(lh);
+          return;
+        }
       } else {
         new_node->L = rh;
-        if (dcas(reinterpret_cast<uint64_t *>(&RightHat), reinterpret_cast<uint64_t>(rh), reinterpret_cast<uint64_t>(new_node),
-                 reinterpret_cast<uint64_t *>(&rh->R), reinterpret_cast<uint64_t>(rhR), reinterpret_cast<uint64_t>(new_node))) return;
+        if (kcas<2>({{&RightHat, rh, new_node},
+                     {&rh->R, rhR, new_node}})) {
+          retire_dead(rhR);
+          return;
+        }
       }
     }
   }
 
   // pop_left
   int pop_front() {
+    reclaim::epoch::guard guard;
     while (true) {
-      Node* lh = LeftHat;
-      Node* lhL = lh->L;
-      Node* lhR = lh->R;
+      Node* lh = mcas_read(&LeftHat);
+      Node* lhL = mcas_read(&lh->L);
+      Node* lhR = mcas_read(&lh->R);
 
       if (lhL == lh) {
-        if (LeftHat == lh) return -1;
+        if (mcas_read(&LeftHat) == lh) return -1;
       } else {
-        if (tcas(reinterpret_cast<uint64_t *>(&LeftHat), reinterpret_cast<uint64_t>(lh), reinterpret_cast<uint64_t>(lhR),
-                 reinterpret_cast<uint64_t *>(&lh->R), reinterpret_cast<uint64_t>(lhR), reinterpret_cast<uint64_t>(lh),
-                 reinterpret_cast<uint64_t *>(&lh->L), reinterpret_cast<uint64_t>(lhL), reinterpret_cast<uint64_t>(lh))) {
+        if (kcas<3>({{&LeftHat, lh, lhR},
+                     {&lh->R, lhR, lh},
+                     {&lh->L, lhL, lh}})) {
           int result = lh->data;
+          retire_dead(lhL);
           return result;
         }
       }
@@ -106,18 +144,20 @@ class Deque {
 
   // pop_right
   int pop_back() {
+    reclaim::epoch::guard guard;
     while (true) {
-      Node* rh = RightHat;
-      Node* rhL = rh->L;
-      Node* rhR = rh->R;
+      Node* rh = mcas_read(&RightHat);
+      Node* rhL = mcas_read(&rh->L);
+      Node* rhR = mcas_read(&rh->R);
 
       if (rhR == rh) {
-        if (RightHat == rh) return -1;
+        if (mcas_read(&RightHat) == rh) return -1;
       } else {
-        if (tcas(reinterpret_cast<uint64_t *>(&RightHat), reinterpret_cast<uint64_t>(rh), reinterpret_cast<uint64_t>(rhL),
-                 reinterpret_cast<uint64_t *>(&rh->L), reinterpret_cast<uint64_t>(rhL), reinterpret_cast<uint64_t>(rh),
-                 reinterpret_cast<uint64_t *>(&rh->R), reinterpret_cast<uint64_t>(rhR), reinterpret_cast<uint64_t>(rh))) {
+        if (kcas<3>({{&RightHat, rh, rhL},
+                     {&rh->L, rhL, rh},
+                     {&rh->R, rhR, rh}})) {
           int result = rh->data;
+          retire_dead(rhR);
           return result;
         }
       }
@@ -2,6 +2,7 @@
 
 #include <climits>
 #include "../mcas/mcas.h"
+#include "../reclaim/epoch.h"
 
 #define TABLE_SIZE 10000
 
@@ -29,20 +30,18 @@ class HashMap {
       return insert_after(next, node);
     }
 
-    if ((next->prev == nullptr) ||
-        ((next->next == nullptr) && next != tail)) {
+    Node *prev = mcas_read(&next->prev);
+    if ((prev == nullptr) ||
+        ((mcas_read(&next->next) == nullptr) && next != tail)) {
       return false;
     }
 
-    Node *prev = next->prev;
-
     node->next = next;
     node->prev = prev;
-    if (qcas((uint64_t *)&node->prev->next, (uint64_t)node->next, (uint64_t)node,
-             (uint64_t *)&next->prev, (uint64_t)node->prev, (uint64_t)node,
-             (uint64_t *)&node->next, (uint64_t)node->next, (uint64_t)next,
-             (uint64_t *)&node->prev, (uint64_t)node->prev, (uint64_t)prev
-    )
+    if (kcas<4>({{&prev->next, next, node},
+                 {&next->prev, prev, node},
+                 {&node->next, next, next},
+                 {&node->prev, prev, prev}})
         ) {
       return true;
     } else {
@@ -59,20 +58,18 @@ class HashMap {
       return insert_before(prev, node);
     }
 
-    if ((prev->next == nullptr) ||
-        ((prev->prev == nullptr) && prev != head)) {
+    Node *next = mcas_read(&prev->next);
+    if ((next == nullptr) ||
+        ((mcas_read(&prev->prev) == nullptr) && prev != head)) {
       return false;
     }
 
-    Node *next = prev->next;
-
     node->prev = prev;
     node->next = next;
-    if (qcas((uint64_t *)&prev->next, (uint64_t)node->next, (uint64_t)node,
-             (uint64_t *)&node->next->prev, (uint64_t)node->prev, (uint64_t)node,
-             (uint64_t *)&node->next, (uint64_t)node->next, (uint64_t)next,
-             (uint64_t *)&node->prev, (uint64_t)node->prev, (uint64_t)prev
-    )
+    if (kcas<4>({{&prev->next, next, node},
+                 {&next->prev, prev, node},
+                 {&node->next, next, next},
+                 {&node->prev, prev, prev}})
         ) {
       return true;
     } else {
@@ -88,16 +85,17 @@ class HashMap {
     if (node == head || node == tail) {
       return true;
     }
-    Node *prev = node->prev;
-    Node *next = node->next;
+    Node *prev = mcas_read(&node->prev);
+    Node *next = mcas_read(&node->next);
     Node *tmp = nullptr;
 
-    if ((prev == nullptr) && (next == nullptr)) return false; // was already deleted
+    // already deleted, possibly between the two reads
+    if ((prev == nullptr) || (next == nullptr)) return false;
 
-    if(qcas((uint64_t*)&prev->next, (uint64_t)node, (uint64_t)next,
-            (uint64_t*)&next->prev, (uint64_t)node, (uint64_t)prev,
-            (uint64_t*)&node->next, (uint64_t)next, (uint64_t)tmp,
-            (uint64_t*)&node->prev, (uint64_t)prev, (uint64_t)tmp)
+    if(kcas<4>({{&prev->next, node, next},
+                {&next->prev, node, prev},
+                {&node->next, next, tmp},
+                {&node->prev, prev, tmp}})
         ) {
       return true;
     } else {
@@ -114,6 +112,20 @@ class HashMap {
       bucket_heads[i]->value = LONG_MIN;
       bucket_tails[i]->prev = bucket_heads[i];
       bucket_tails[i]->value = LONG_MAX;
+      mcas::stats::label(this, &bucket_heads[i]->next, sizeof(Node*), "HashMap::bucket_heads", i, "->next");
+      mcas::stats::label(this, &bucket_tails[i]->prev, sizeof(Node*), "HashMap::bucket_tails", i, "->prev");
+    }
+  }
+
+  ~HashMap() {
+    mcas::stats::forget(this);
+    for (int i = 0; i < TABLE_SIZE; i++) {
+      Node *curr = bucket_heads[i];
+      while (curr != nullptr) {
+        Node *next = curr->next;
+        delete curr;
+        curr = next;
+      }
     }
   }
 
@@ -123,16 +135,17 @@ class HashMap {
     new_node->key = key;
     new_node->value = value;
 
+    reclaim::epoch::guard guard;
     while (true) {
       retry:
       new_node->next = nullptr;
       new_node->prev = nullptr;
 
-      Node *curr = bucket_heads[index]->next;
+      Node *curr = mcas_read(&bucket_heads[index]->next);
       Node *tail = bucket_tails[index];
 
       while (curr != nullptr && curr != tail && curr->key != key) {
-        curr = curr->next;
+        curr = mcas_read(&curr->next);
       }
 
       if (curr == nullptr) goto retry;
@@ -144,7 +157,7 @@ class HashMap {
         }
       }
       if (curr->key == key) {
-        if ((cas((uint64_t *)&curr->value, (uint64_t)curr->value, (uint64_t)value))) {
+        if ((kcas<1>({{&curr->value, mcas_read(&curr->value), value}}))) {
           delete new_node;
           return;
         } else {
@@ -157,13 +170,15 @@ class HashMap {
 
   bool contains(long key) {
     unsigned long index = std::hash<long>{}(key) % TABLE_SIZE;
-    Node *curr = bucket_heads[index]->next;
+    reclaim::epoch::guard guard;
     Node *tail = bucket_tails[index];
 
     while(true) {
+      // restart from the bucket head if a node got unlinked under us
+      Node *curr = mcas_read(&bucket_heads[index]->next);
       while (curr != tail && curr != nullptr) {
         if (curr->key == key) return true;
-        curr = curr->next;
+        curr = mcas_read(&curr->next);
       }
       if (curr == tail) return false;
     }
@@ -171,34 +186,40 @@ class HashMap {
 
   void remove(long key) {
     unsigned long index = std::hash<long>{}(key) % TABLE_SIZE;
+    reclaim::epoch::guard guard;
 
     while (true) {
       retry:
-      Node *curr = bucket_heads[index]->next;
+      Node *curr = mcas_read(&bucket_heads[index]->next);
       Node *tail = bucket_tails[index];
 
       while (curr != nullptr && curr != tail && curr->key != key) {
-        curr = curr->next;
+        curr = mcas_read(&curr->next);
       }
 
       if (curr == nullptr) goto retry;
       if (curr == tail) return;
       if (curr->key == key) {
-        if (delete_node(curr)) return;
+        if (delete_node(curr)) {
+          reclaim::epoch::retire(curr);
+          return;
+        }
       }
     }
   }
 
   long find(long key) {
     unsigned long index = std::hash<long>{}(key) % TABLE_SIZE;
+    reclaim::epoch::guard guard;
 
-    Node *curr = bucket_heads[index]->next;
     Node *tail = bucket_tails[index];
 
     while(true) {
+      // restart from the bucket head if a node got unlinked under us
+      Node *curr = mcas_read(&bucket_heads[index]->next);
       while (curr != tail && curr != nullptr) {
-        if (curr->key == key) return curr->value;
-        curr = curr->next;
+        if (curr->key == key) return mcas_read(&curr->value);
+        curr = mcas_read(&curr->next);
       }
       if (curr == tail) return LONG_MIN;
     }
@@ -0,0 +1,81 @@
+// Bounded MPMC queue over an array of words. Every slot holds either EMPTY
+// or a value tagged with FULL; a push claims the slot at the tail and
+// advances the tail in one dcas, a pop empties the slot at the head and
+// advances the head in another. The indices only grow, so the dcas cannot
+// suffer ABA, and slot and index always agree: the slot at the tail is
+// occupied exactly when the queue is full, the one at the head is empty
+// exactly when the queue is.
+
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "../mcas/mcas.h"
+#include "../padding.h"
+
+namespace lockfree_mcas {
+
+class RingQueue {
+ private:
+  static const uint64_t EMPTY = 0;
+  static const uint64_t FULL = 1ull << 32;  // clear of the descriptor tag bits
+
+  uint64_t *slots;
+  uint64_t mask;
+  CACHE_ALIGNED uint64_t head;
+  CACHE_ALIGNED uint64_t tail;
+
+ public:
+  // capacity is rounded up to a power of two
+  explicit RingQueue(size_t capacity) : head(0), tail(0) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    slots = new uint64_t[size]();
+    mask = size - 1;
+    mcas::stats::label(this, &head, sizeof(head), "RingQueue::head");
+    mcas::stats::label(this, &tail, sizeof(tail), "RingQueue::tail");
+    mcas::stats::label_array(this, slots, size, sizeof(uint64_t), "RingQueue::slots");
+  }
+
+  ~RingQueue() {
+    mcas::stats::forget(this);
+    delete[] slots;
+  }
+
+  RingQueue(const RingQueue &) = delete;
+  RingQueue &operator=(const RingQueue &) = delete;
+
+  size_t capacity() const { return mask + 1; }
+
+  // false if the queue is full
+  bool push(int item) {
+    uint64_t value = FULL | static_cast<uint32_t>(item);
+    while (true) {
+      uint64_t t = mcas_read(&tail);
+      uint64_t *slot = &slots[t & mask];
+      if (mcas_read(slot) != EMPTY) {
+        if (mcas_read(&tail) == t) return false;
+        continue;
+      }
+      if (kcas<2>({{&tail, t, t + 1}, {slot, EMPTY, value}})) return true;
+    }
+  }
+
+  // -1 if the queue is empty
+  int pop() {
+    while (true) {
+      uint64_t h = mcas_read(&head);
+      uint64_t *slot = &slots[h & mask];
+      uint64_t value = mcas_read(slot);
+      if (value == EMPTY) {
+        if (mcas_read(&head) == h) return -1;
+        continue;
+      }
+      if (kcas<2>({{&head, h, h + 1}, {slot, value, EMPTY}}))
+        return static_cast<int>(static_cast<uint32_t>(value));
+    }
+  }
+};
+
+}  // namespace lockfree_mcas
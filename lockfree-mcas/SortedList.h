@@ -4,10 +4,13 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include "../alloc/pool.h"
 #include "../mcas/mcas.h"
+#include "../reclaim/epoch.h"
 
 namespace lockfree_mcas {
 
+template <template <typename> class Allocator = alloc::heap>
 class SortedList {
  private:
   struct Node {
@@ -16,6 +19,7 @@ class SortedList {
     Node *prev;
     Node() = default;
   };
+  typedef Allocator<Node> node_alloc;
 
   Node *head;
   Node *tail;
@@ -25,20 +29,18 @@ class SortedList {
       return insert_after(next, node);
     }
 
-    if ((next->prev == nullptr) ||
-        ((next->next == nullptr) && next != tail)) {
+    Node *prev = mcas_read(&next->prev);
+    if ((prev == nullptr) ||
+        ((mcas_read(&next->next) == nullptr) && next != tail)) {
       return false;
     }
 
-    Node *prev = next->prev;
-
     node->next = next;
     node->prev = prev;
-    if (qcas((uint64_t *)&node->prev->next, (uint64_t)node->next, (uint64_t)node,
-             (uint64_t *)&next->prev, (uint64_t)node->prev, (uint64_t)node,
-             (uint64_t *)&node->next, (uint64_t)node->next, (uint64_t)next,
-             (uint64_t *)&node->prev, (uint64_t)node->prev, (uint64_t)prev
-             )
+    if (kcas<4>({{&prev->next, next, node},
+                 {&next->prev, prev, node},
+                 {&node->next, next, next},
+                 {&node->prev, prev, prev}})
         ) {
       return true;
     } else {
@@ -51,20 +53,18 @@ class SortedList {
       return insert_before(prev, node);
     }
 
-    if ((prev->next == nullptr) ||
-        ((prev->prev == nullptr) && prev != head)) {
+    Node *next = mcas_read(&prev->next);
+    if ((next == nullptr) ||
+        ((mcas_read(&prev->prev) == nullptr) && prev != head)) {
       return false;
     }
 
-    Node *next = prev->next;
-
     node->prev = prev;
     node->next = next;
-    if (qcas((uint64_t *)&prev->next, (uint64_t)node->next, (uint64_t)node,
-             (uint64_t *)&node->next->prev, (uint64_t)node->prev, (uint64_t)node,
-             (uint64_t *)&node->next, (uint64_t)node->next, (uint64_t)next,
-             (uint64_t *)&node->prev, (uint64_t)node->prev, (uint64_t)prev
-             )
+    if (kcas<4>({{&prev->next, next, node},
+                 {&next->prev, prev, node},
+                 {&node->next, next, next},
+                 {&node->prev, prev, prev}})
         ) {
       return true;
     } else {
@@ -76,16 +76,17 @@ class SortedList {
       if (node == head || node == tail) {
         return true;
       }
-      Node *prev = node->prev;
-      Node *next = node->next;
+      Node *prev = mcas_read(&node->prev);
+      Node *next = mcas_read(&node->next);
       Node *tmp = nullptr;
 
-      if ((prev == nullptr) && (next == nullptr)) return false; // was already deleted
+      // already deleted, possibly between the two reads
+      if ((prev == nullptr) || (next == nullptr)) return false;
 
-      if(qcas((uint64_t*)&prev->next, (uint64_t)node, (uint64_t)next,
-              (uint64_t*)&next->prev, (uint64_t)node, (uint64_t)prev,
-              (uint64_t*)&node->next, (uint64_t)next, (uint64_t)tmp,
-              (uint64_t*)&node->prev, (uint64_t)prev, (uint64_t)tmp)
+      if(kcas<4>({{&prev->next, node, next},
+                  {&next->prev, node, prev},
+                  {&node->next, next, tmp},
+                  {&node->prev, prev, tmp}})
           ) {
         return true;
       } else {
@@ -95,29 +96,42 @@ class SortedList {
 
  public:
   SortedList() {
-    head = new Node();
-    tail = new Node();
+    head = node_alloc::allocate();
+    tail = node_alloc::allocate();
     head->next = tail;
     tail->prev = head;
+    mcas::stats::label(this, &head->next, sizeof(head->next), "SortedList::head", -1, "->next");
+    mcas::stats::label(this, &tail->prev, sizeof(tail->prev), "SortedList::tail", -1, "->prev");
+  }
+
+  ~SortedList() {
+    mcas::stats::forget(this);
+    Node *curr = head;
+    while (curr != nullptr) {
+      Node *next = curr->next;
+      node_alloc::free(curr);
+      curr = next;
+    }
   }
 
   void insert(int data) {
-    Node *new_node = new Node();
+    Node *new_node = node_alloc::allocate();
     new_node->data = data;
 
+    reclaim::epoch::guard guard;
     while (true) {
     retry:
       new_node->next = nullptr;
       new_node->prev = nullptr;
 
-      Node *curr = head->next;
+      Node *curr = mcas_read(&head->next);
 
       while (curr != nullptr && curr != tail && curr->data < data) {
-        curr = curr->next;
+        curr = mcas_read(&curr->next);
       }
 
       if (curr == nullptr) goto retry;
-      if ((curr->next == nullptr) && (curr->prev == nullptr)) goto retry; //node was deleted
+      if ((mcas_read(&curr->next) == nullptr) && (mcas_read(&curr->prev) == nullptr)) goto retry; //node was deleted
 
       if (insert_before(curr, new_node)) return;
 
@@ -125,41 +139,46 @@ class SortedList {
   }
 
   void remove(int data) {
+    reclaim::epoch::guard guard;
     while (true) {
       retry:
-      Node *curr = head->next;
+      Node *curr = mcas_read(&head->next);
 
       while (curr != nullptr && curr != tail && curr->data < data) {
-        curr = curr->next;
+        curr = mcas_read(&curr->next);
       }
 
       if (curr == nullptr) goto retry;
       if (curr == tail) return;
       if (curr->data != data) return;
-      if ((curr->next == nullptr) || (curr->prev == nullptr)) goto retry;
+      if ((mcas_read(&curr->next) == nullptr) || (mcas_read(&curr->prev) == nullptr)) goto retry;
 
-      if (delete_node(curr)) return;
+      if (delete_node(curr)) {
+        reclaim::epoch::retire(curr, node_alloc::free);
+        return;
+      }
     }
   }
 
   int count(int val) {
+    reclaim::epoch::guard guard;
     while(true) {
       int n_val = 0;
-      auto curr = head->next;
+      auto curr = mcas_read(&head->next);
       while (curr != tail && curr != nullptr) {
         if (curr->data == val) n_val++;
-        curr = curr->next;
+        curr = mcas_read(&curr->next);
       }
       if (curr != nullptr) return n_val;
     }
   }
 
   void print_all() {
-    auto curr = head->next;
+    auto curr = mcas_read(&head->next);
 
     while (curr != tail) {
       std::cout << curr->data << " ";
-      curr = curr->next;
+      curr = mcas_read(&curr->next);
     }
     std::cout << std::endl;
   }
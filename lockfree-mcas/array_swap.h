@@ -39,6 +39,7 @@ void datum_init(sps* s) {
 }
 
 void datum_free(sps* s) {
+  mcas::stats::forget(s);
   for (int i = 0; i < NUM_ROWS; i++) {
     free(s->array[i].elements_);
   }
@@ -50,6 +51,7 @@ void initialize() {
   S->num_sub_items_ = NUM_SUB_ITEMS;
   S->array = (Datum*)malloc(sizeof(Datum) * NUM_ROWS);
   datum_init(S);
+  mcas::stats::label_array(S, S->array, NUM_ROWS, sizeof(Datum), "ArraySwap::array", ".elements_");
 
   // fprintf(stderr, "Created array at %p\n", (void*)S);
 }
@@ -69,14 +71,11 @@ bool swap(unsigned int index_a, unsigned int index_b) {
   // }
 
   while (true) {
-    Element* addr_a = S->array[index_a].elements_;
-    Element* addr_b = S->array[index_b].elements_;
-
-    if (dcas(reinterpret_cast<uint64_t*>(&S->array[index_a].elements_),
-         reinterpret_cast<uint64_t>(addr_a), reinterpret_cast<uint64_t>(addr_b),
-         reinterpret_cast<uint64_t*>(&S->array[index_b].elements_),
-         reinterpret_cast<uint64_t>(addr_b),
-         reinterpret_cast<uint64_t>(addr_a))) return true;
+    Element* addr_a = mcas_read(&S->array[index_a].elements_);
+    Element* addr_b = mcas_read(&S->array[index_b].elements_);
+
+    if (kcas<2>({{&S->array[index_a].elements_, addr_a, addr_b},
+                 {&S->array[index_b].elements_, addr_b, addr_a}})) return true;
   }
 }
 
@@ -6,8 +6,10 @@
 #include <climits>
 #include <cstdint>
 #include <cstdlib>
+#include <vector>
 
 #include "DPointer.h"
+#include "../reclaim/reclaim.h"
 
 namespace lockfree {
 
@@ -46,13 +48,30 @@ class SeekRecord {
   }
 };
 
+// A seek walks past nodes whose removal it cannot detect (an edge is only
+// marked before the node below it is unlinked, not after), so it has no
+// link to re-validate a hazard pointer against: the tree reclaims through
+// epochs whichever scheme is selected, unless reclamation is off.
 class BinarySearchTree {
  public:
-  static Node *grandParentHead;
-  static Node *parentHead;
-  static BinarySearchTree *obj;
+  Node *grandParentHead;
+  Node *parentHead;
   BinarySearchTree() { createHeadNodes(); }
+  ~BinarySearchTree() {
+    std::vector<Node *> pending = {grandParentHead};
+    while (!pending.empty()) {
+      Node *node = pending.back();
+      pending.pop_back();
+      if (node->lChild.ptr) pending.push_back(node->lChild.ptr);
+      if (node->rChild.ptr) pending.push_back(node->rChild.ptr);
+      delete node;
+    }
+  }
+  static reclaim::Scheme scheme() {
+    return reclaim::scheme() == reclaim::NONE ? reclaim::NONE : reclaim::EPOCH;
+  }
   long lookup(long target) {
+    reclaim::guard guard(scheme());
     Node *node = grandParentHead;
     while (node->lChild.ptr !=
            NULL)  // loop until a leaf or dummy node is reached
@@ -72,7 +91,8 @@ class BinarySearchTree {
     int nthChild;
     Node *node;
     Node *pnode;
-    SeekRecord *s;
+    SeekRecord s;
+    reclaim::guard guard(scheme());
     while (true) {
       nthChild = -1;
       pnode = parentHead;
@@ -116,6 +136,7 @@ class BinarySearchTree {
                               oldChild)) {
           return;
         } else {
+          discard(internalNode, node);
           // insert failed; help the conflicting delete operation
           if (node == pnode->lChild.ptr) {  // address has not changed. So
             // CAS would have failed coz of flag/mark only
@@ -129,6 +150,7 @@ class BinarySearchTree {
                               DPointer<Node, sizeof(size_t)>(oldChild, 0))) {
           return;
         } else {
+          discard(internalNode, node);
           if (node == pnode->rChild.ptr) {
             s = seek(insertKey);
             cleanUp(insertKey, s);
@@ -139,17 +161,18 @@ class BinarySearchTree {
   }
   void remove(long deleteKey) {
     bool isCleanUp = false;
-    SeekRecord *s;
+    SeekRecord s;
     Node *parent;
     Node *leaf = NULL;
+    reclaim::guard guard(scheme());
     while (true) {
       s = seek(deleteKey);
       if (!isCleanUp) {
-        leaf = s->leaf;
+        leaf = s.leaf;
         if (leaf->key != deleteKey) {
           return;
         } else {
-          parent = s->parent;
+          parent = s.parent;
           if (deleteKey < parent->key) {
             if (parent->lChild.cas(DPointer<Node, sizeof(size_t)>(leaf, 2),
                                    leaf)) {
@@ -180,7 +203,7 @@ class BinarySearchTree {
           }
         }
       } else {
-        if (s->leaf == leaf) {
+        if (s.leaf == leaf) {
           // do cleanup
           if (cleanUp(deleteKey, s)) {
             return;
@@ -217,19 +240,30 @@ class BinarySearchTree {
     return stamp;
   }
 
-  bool cleanUp(long key, SeekRecord *s) {
-    Node *ancestor = s->ancestor;
-    Node *parent = s->parent;
-    Node *oldSuccessor;
-    size_t oldStamp;
+  // frees the nodes of an insert that lost its CAS, all but the leaf it
+  // would have replaced
+  static void discard(Node *internalNode, Node *oldChild) {
+    if (internalNode->lChild.ptr != oldChild) delete internalNode->lChild.ptr;
+    else delete internalNode->rChild.ptr;
+    delete internalNode;
+  }
+
+  bool cleanUp(long key, const SeekRecord &s) {
+    Node *ancestor = s.ancestor;
+    Node *parent = s.parent;
     Node *sibling;
+    Node *flagged;
     size_t siblingStamp;
+    // an insert helps after a fresh seek, which may find a parent nobody is
+    // removing a leaf from: there is nothing to clean up then
+    if (parent->lChild.mark < 2 && parent->rChild.mark < 2) return false;
     if (key < parent->key) {          // xl case
       if (parent->lChild.mark > 1) {  // check if parent to leaf edge is
                                       // already flagged .10 or 11
         // leaf node is flagged for deletion. tag the sibling edge to
         // prevent
         // any modification at this edge now
+        flagged = parent->lChild.ptr;
         sibling = parent->rChild.ptr;
         siblingStamp = parent->rChild.mark;
         siblingStamp = setTag(siblingStamp);  // set only tag
@@ -240,6 +274,7 @@ class BinarySearchTree {
       } else {
         // leaf node is not flagged. So sibling node must have been flagged
         // for deletion
+        flagged = parent->rChild.ptr;
         sibling = parent->lChild.ptr;
         siblingStamp = parent->lChild.mark;
         siblingStamp = setTag(siblingStamp);  // set only tag
@@ -254,6 +289,7 @@ class BinarySearchTree {
         // leaf node is flagged for deletion. tag the sibling edge to
         // prevent
         // any modification at this edge now
+        flagged = parent->rChild.ptr;
         sibling = parent->lChild.ptr;
         siblingStamp = parent->lChild.mark;
         siblingStamp = setTag(siblingStamp);  // set only tag
@@ -264,6 +300,7 @@ class BinarySearchTree {
       } else {
         // leaf node is not flagged. So sibling node must have been flagged
         // for deletion
+        flagged = parent->lChild.ptr;
         sibling = parent->rChild.ptr;
         siblingStamp = parent->rChild.mark;
         siblingStamp = setTag(siblingStamp);  // set only tag
@@ -273,44 +310,60 @@ class BinarySearchTree {
         siblingStamp = parent->rChild.mark;
       }
     }
-    if (key < ancestor->key) {
-      siblingStamp = copyFlag(siblingStamp);  // copy only the flag
-      oldSuccessor = ancestor->lChild.ptr;
-      oldStamp = ancestor->lChild.mark;
-      return (ancestor->lChild.cas(
-          DPointer<Node, sizeof(size_t)>(sibling, siblingStamp),
-          DPointer<Node, sizeof(size_t)>(oldSuccessor, oldStamp)));
-    } else {
-      siblingStamp = copyFlag(siblingStamp);  // copy only the flag
-      oldSuccessor = ancestor->rChild.ptr;
-      oldStamp = ancestor->rChild.mark;
-      return (ancestor->rChild.cas(
-          DPointer<Node, sizeof(size_t)>(sibling, siblingStamp),
-          DPointer<Node, sizeof(size_t)>(oldSuccessor, oldStamp)));
+    // the ancestor edge must still lead to the successor, untagged: the
+    // chain from the successor down to the parent is then frozen and goes
+    // away as a whole
+    DPointer<Node, sizeof(size_t)> *edge =
+        key < ancestor->key ? &ancestor->lChild : &ancestor->rChild;
+    siblingStamp = copyFlag(siblingStamp);  // copy only the flag
+    if (!edge->cas(DPointer<Node, sizeof(size_t)>(sibling, siblingStamp),
+                   DPointer<Node, sizeof(size_t)>(s.successor, 0)))
+      return false;
+    retireChain(key, s.successor, parent, flagged);
+    return true;
+  }
+
+  // every node between the successor and the parent has a tagged edge on
+  // the access path and a flagged leaf on the other side
+  void retireChain(long key, Node *node, Node *parent, Node *flagged) {
+    reclaim::Scheme s = scheme();
+    while (node != parent) {
+      Node *next;
+      if (key < node->key) {
+        next = node->lChild.ptr;
+        reclaim::retire(node->rChild.ptr, s);
+      } else {
+        next = node->rChild.ptr;
+        reclaim::retire(node->lChild.ptr, s);
+      }
+      reclaim::retire(node, s);
+      node = next;
     }
+    reclaim::retire(flagged, s);
+    reclaim::retire(parent, s);
   }
 
-  SeekRecord *seek(long key) {
+  SeekRecord seek(long key) {
     DPointer<Node, sizeof(size_t)> parentField;
     DPointer<Node, sizeof(size_t)> currentField;
     Node *current;
     // initialize the seek record
-    SeekRecord *s = new SeekRecord(grandParentHead, parentHead, parentHead,
-                                   parentHead->lChild.ptr);
-    parentField = s->ancestor->lChild;
-    currentField = s->successor->lChild;
+    SeekRecord s(grandParentHead, parentHead, parentHead,
+                 parentHead->lChild.ptr);
+    parentField = parentHead->lChild;
+    currentField = s.leaf->lChild;
     while (currentField.ptr != NULL) {
       current = currentField.ptr;
       // move down the tree
       // check if the edge from the current parent node in the access path is
       //       tagged
       if (parentField.mark == 0 || parentField.mark == 2) {  // 00, 10 untagged
-        s->ancestor = s->parent;
-        s->successor = s->leaf;
+        s.ancestor = s.parent;
+        s.successor = s.leaf;
       }
       // advance parent and leaf pointers
-      s->parent = s->leaf;
-      s->leaf = current;
+      s.parent = s.leaf;
+      s.leaf = current;
       parentField = currentField;
       if (key < current->key) {
         currentField = current->lChild;
@@ -337,6 +390,7 @@ class BinarySearchTree {
   }
 
   long get_min() {
+    reclaim::guard guard(scheme());
     Node *node = grandParentHead;
     long min = LONG_MAX;
 
@@ -355,6 +409,7 @@ class BinarySearchTree {
   }
 
   long get_max() {
+    reclaim::guard guard(scheme());
     Node *node = grandParentHead;
     long max = LONG_MIN;
 
@@ -371,8 +426,4 @@ class BinarySearchTree {
     return max;
   }
 };
-
-lockfree::Node *lockfree::BinarySearchTree::grandParentHead = nullptr;
-lockfree::Node *lockfree::BinarySearchTree::parentHead = nullptr;
-lockfree::BinarySearchTree *lockfree::BinarySearchTree::obj = nullptr;
 }  // namespace lockfree
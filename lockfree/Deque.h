@@ -8,6 +8,8 @@
 #include <experimental/optional>
 #include <memory>
 
+#include "../padding.h"
+
 namespace lockfree {
 
 namespace deque {
@@ -96,14 +98,14 @@ class Reclaimer {
 template <typename T>
 class Deque {
  private:
-  std::atomic<long> top;
-  std::atomic<long> bottom;
+  CACHE_ALIGNED std::atomic<long> top;     // stealers
+  CACHE_ALIGNED std::atomic<long> bottom;  // owner
   Buffer<T> *unlinked;
   static const int log_initial_size = 4;
 
  public:
   Reclaimer reclaimer;
-  std::atomic<Buffer<T> *> buffer;
+  CACHE_ALIGNED std::atomic<Buffer<T> *> buffer;  // read by every steal
 
   Deque()
       : top(0),
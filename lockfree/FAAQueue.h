@@ -0,0 +1,124 @@
+// Unbounded MPMC queue built on fetch-and-add, after Correia and
+// Ramalhete's FAAArrayQueue, a simplified LCRQ (Morrison and Afek 2013):
+// a linked list of fixed-size arrays. Producers and consumers take a slot
+// of the tail and head array with a FAA on its enqueue or dequeue index, so
+// contended threads never retry on a lost CAS; only filling a slot and
+// moving on to the next array use CAS. A consumer that overtakes a slow
+// producer marks the slot TAKEN and both move on. Unlike LCRQ the arrays
+// are not reused: a drained array is unlinked and reclaimed.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "../mcas/backoff.h"
+#include "../padding.h"
+#include "../reclaim/reclaim.h"
+
+namespace lockfree {
+
+class FAAQueue {
+ private:
+  static const long BUFFER_SIZE = 1024;
+  static const uint64_t EMPTY = 0;
+  static const uint64_t TAKEN = 1;
+  static const uint64_t FULL = 1ull << 32;
+
+  struct Node {
+    CACHE_ALIGNED std::atomic<long> deqidx;
+    CACHE_ALIGNED std::atomic<long> enqidx;
+    Node *next;
+    std::atomic<uint64_t> items[BUFFER_SIZE];
+
+    // a node starts out holding the value that did not fit its predecessor
+    Node(uint64_t first) : deqidx(0), enqidx(first == EMPTY ? 0 : 1), next(nullptr) {
+      items[0].store(first, std::memory_order_relaxed);
+      for (long i = 1; i < BUFFER_SIZE; i++) items[i].store(EMPTY, std::memory_order_relaxed);
+    }
+  };
+
+  CACHE_ALIGNED Node *head;
+  CACHE_ALIGNED Node *tail;
+
+  static bool cas(Node **link, Node *expected, Node *desired) {
+    return __atomic_compare_exchange_n(link, &expected, desired, false, __ATOMIC_SEQ_CST,
+                                       __ATOMIC_SEQ_CST);
+  }
+
+ public:
+  FAAQueue() {
+    Node *sentinel = new Node(EMPTY);
+    head = sentinel;
+    tail = sentinel;
+  }
+
+  ~FAAQueue() {
+    while (head) {
+      Node *next = head->next;
+      delete head;
+      head = next;
+    }
+  }
+
+  FAAQueue(const FAAQueue &) = delete;
+  FAAQueue &operator=(const FAAQueue &) = delete;
+
+  void push(int item) {
+    uint64_t value = FULL | static_cast<uint32_t>(item);
+    reclaim::guard guard;
+    while (true) {
+      Node *last = reclaim::protect(0, &tail);
+      long idx = last->enqidx.fetch_add(1);
+      if (idx > BUFFER_SIZE - 1) {  // this array is full
+        if (last != __atomic_load_n(&tail, __ATOMIC_ACQUIRE)) continue;
+        Node *next = __atomic_load_n(&last->next, __ATOMIC_ACQUIRE);
+        if (next == nullptr) {
+          Node *node = new Node(value);
+          if (cas(&last->next, nullptr, node)) {
+            cas(&tail, last, node);
+            mcas::backoff::success();
+            return;
+          }
+          delete node;
+          mcas::backoff::failure();
+        } else {
+          cas(&tail, last, next);
+        }
+        continue;
+      }
+      uint64_t expected = EMPTY;
+      if (last->items[idx].compare_exchange_strong(expected, value)) {
+        mcas::backoff::success();
+        return;
+      }
+      /* a consumer gave up on this slot before we filled it */
+      mcas::backoff::failure();
+    }
+  }
+
+  // -1 if the queue is empty
+  int pop() {
+    reclaim::guard guard;
+    while (true) {
+      Node *first = reclaim::protect(0, &head);
+      if (first->deqidx.load() >= first->enqidx.load() &&
+          __atomic_load_n(&first->next, __ATOMIC_ACQUIRE) == nullptr)
+        return -1;
+      long idx = first->deqidx.fetch_add(1);
+      if (idx > BUFFER_SIZE - 1) {  // this array is drained
+        Node *next = __atomic_load_n(&first->next, __ATOMIC_ACQUIRE);
+        if (next == nullptr) return -1;
+        cas(&tail, first, next);  // never retire the node the tail is on
+        if (cas(&head, first, next)) reclaim::retire(first);
+        continue;
+      }
+      uint64_t value = first->items[idx].exchange(TAKEN);
+      if (value == EMPTY) continue;  // overtook the producer of this slot
+      mcas::backoff::success();
+      return static_cast<int>(static_cast<uint32_t>(value));
+    }
+  }
+};
+
+}  // namespace lockfree
@@ -2,6 +2,7 @@
 
 #include "DPointer.h"
 #include "DoublyLinkedList.h"
+#include "../reclaim/reclaim.h"
 #include <climits>
 
 #define TABLE_SIZE 10000
@@ -27,22 +28,6 @@ class Lockprogram {
         this->item = x;
         this->next = DPointer<LockFreehash::Node, sizeof(size_t)>();
       }
-      Node* getnext() {
-        bool cMarked[] = {false};
-        bool sMarked[] = {false};
-        Node* succ;
-        Node* entry = this->next.ptr;
-        cMarked[0] = this->next.mark;
-        while (cMarked[0]) {
-          succ = entry->next.ptr;
-          sMarked[0] = entry->next.mark;
-          this->next.ptr = succ;
-          this->next.mark = sMarked[0];
-          entry = this->next.ptr;
-          cMarked[0] = this->next.mark;
-        }
-        return entry;
-      }
     };
 
    public:
@@ -61,14 +46,30 @@ class Lockprogram {
     const static int HI_MASK = 0x00800000;
     const static int MASK = 0x00FFFFFF;
     Node* head;
+    bool owner;
     LockFreehash() {
+      this->owner = true;
       this->head = new Node(0);
       Node* tail = new Node(2147483647);
       while (!head->next.cas(
           DPointer<LockFreehash::Node, sizeof(size_t)>(tail, 0), NULL))
         ;
     }
-    LockFreehash(Node* e) { this->head = e; }
+    LockFreehash(Node* e) {
+      this->head = e;
+      this->owner = false;
+    }
+    LockFreehash(const LockFreehash&) = delete;
+    LockFreehash& operator=(const LockFreehash&) = delete;
+    ~LockFreehash() {
+      if (!owner) return;
+      Node* node = head;
+      while (node) {
+        Node* next = node->next.ptr;
+        delete node;
+        node = next;
+      }
+    }
     int hashcode(int x) {
       std::hash<int> hash_fn;
       int a = hash_fn(x);
@@ -94,64 +95,102 @@ class Lockprogram {
       return reverse(code | HI_MASK);
     }
     int makeSentinelKey(int key) { return reverse(key & MASK); }
-    Window* find(Node* head, int key) {
-      Node* pred = head;
-      Node* curr = head->getnext();
-      while (curr->key < key) {
-        pred = curr;
-        curr = pred->getnext();
+    // Michael's list (Michael 2002, "High performance dynamic lock-free hash
+    // tables and list-based sets"): a node is deleted once the mark on its
+    // own next link is set, and unlinked with a CAS on its predecessor's
+    // link by whichever thread finds it next, which also retires it. pred
+    // and curr stay protected by hazard pointers 2 and 1 until the caller's
+    // guard ends.
+    static Node* load(Node* const* link) {
+      return __atomic_load_n(link, __ATOMIC_ACQUIRE);
+    }
+    static size_t load(const size_t* mark) {
+      return __atomic_load_n(mark, __ATOMIC_ACQUIRE);
+    }
+    // false if the list changed under the search and it must restart
+    bool search(Node* head, int key, Window& window) {
+      Node* pred = head;  // bucket sentinels are never retired
+      Node* curr = reclaim::protect(1, &pred->next.ptr);
+      while (true) {
+        Node* succ = load(&curr->next.ptr);
+        size_t marked = load(&curr->next.mark);
+        reclaim::publish(0, succ);
+        if (load(&curr->next.ptr) != succ || load(&curr->next.mark) != marked)
+          return false;
+        if (load(&pred->next.ptr) != curr || load(&pred->next.mark)) return false;
+        if (!marked) {
+          if (curr->key >= key) {  // the tail sentinel ends every search
+            window = Window(pred, curr);
+            return true;
+          }
+          pred = curr;
+          reclaim::publish(2, pred);
+        } else {
+          if (!pred->next.cas(DPointer<Node, sizeof(size_t)>(succ, 0),
+                              DPointer<Node, sizeof(size_t)>(curr, 0)))
+            return false;
+          reclaim::retire(curr);
+        }
+        curr = succ;
+        reclaim::publish(1, curr);
       }
-      return new Window(pred, curr);
+    }
+    Window find(Node* head, int key) {
+      Window window;
+      while (!search(head, key, window))
+        ;
+      return window;
     }
     bool add(int x) {
       int key = makeRegularKey(x);
-      bool splice;
+      Node* entry = new Node(key, x);
+      reclaim::guard guard;
       while (true) {
-        Window* window = find(head, key);
-        Node* pred = window->pred;
-        Node* curr = window->curr;
-        Node* entry = new Node(key, x);
-        entry->next = DPointer<LockFreehash::Node, sizeof(size_t)>(curr, 0);
-        splice = pred->next.cas(DPointer<Node, sizeof(size_t)>(entry, 0), curr);
-        if (splice)
+        Window window = find(head, key);
+        entry->next = DPointer<LockFreehash::Node, sizeof(size_t)>(window.curr, 0);
+        if (window.pred->next.cas(DPointer<Node, sizeof(size_t)>(entry, 0),
+                                  DPointer<Node, sizeof(size_t)>(window.curr, 0)))
           return true;
-        else
-          continue;
       }
     }
     bool remove(int x) {
       int key = makeRegularKey(x);
-      bool snip;
+      reclaim::guard guard;
       while (true) {
-        Window* window = find(head, key);
-        Node* pred = window->pred;
-        Node* curr = window->curr;
+        Window window = find(head, key);
+        Node* pred = window.pred;
+        Node* curr = window.curr;
         if (curr->key != key) {
           return false;
         } else {
-          snip =
-              pred->next.cas(DPointer<Node, sizeof(size_t)>(curr, true), curr);
-          if (snip)
-            return true;
-          else
+          Node* succ = load(&curr->next.ptr);
+          if (!curr->next.cas(DPointer<Node, sizeof(size_t)>(succ, 1),
+                              DPointer<Node, sizeof(size_t)>(succ, 0)))
             continue;
+          // unlink it now if nothing changed, leave it to a search otherwise
+          if (pred->next.cas(DPointer<Node, sizeof(size_t)>(succ, 0),
+                             DPointer<Node, sizeof(size_t)>(curr, 0)))
+            reclaim::retire(curr);
+          else
+            find(head, key);
+          return true;
         }
       }
     }
     bool contains(int x) {
       int key = makeRegularKey(x);
-      Window* window = find(head, key);
-      Node* pred = window->pred;
-      Node* curr = window->curr;
-      return curr->key == key;
+      reclaim::guard guard;
+      Window window = find(head, key);
+      return window.curr->key == key;
     }
     LockFreehash* getsentinel(int index) {
       int key = makeSentinelKey(index);
       bool splice;
+      reclaim::guard guard;
       while (true) {
-        Window* window = find(head, key);
-        Node* pred = window->pred;
-        Node* curr = window->curr;
+        Window window = find(head, key);
+        Node* pred = window.pred;
+        Node* curr = window.curr;
         // is the key present?
         if (curr->key == key) {
           return new LockFreehash(curr);
@@ -191,6 +230,9 @@ class Lockprogram {
     this->bucketSize = 2;
     this->setSize = 0;
   }
+  ~Lockprogram() {
+    for (LockFreehash* b : bucket) delete b;
+  }
   LockFreehash* getBucketList(int myBucket) {
     if (this->bucket[myBucket] == NULL) initializeBucket(myBucket);
     return this->bucket[myBucket];
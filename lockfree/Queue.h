@@ -3,6 +3,10 @@
 
 #pragma once
 
+#include "../mcas/backoff.h"
+#include "../padding.h"
+#include "../reclaim/reclaim.h"
+
 namespace lockfree {
 
 class Queue {
@@ -17,8 +21,8 @@ class Queue {
   };
 
  private:
-  Node *head;
-  Node *tail;
+  CACHE_ALIGNED Node *head;
+  CACHE_ALIGNED Node *tail;
 
   static size_t compareAndExchange( volatile size_t* addr, size_t oldval, size_t
   newval ){
@@ -35,12 +39,21 @@ class Queue {
     this->tail = sentinel;
   }
 
+  ~Queue() {
+    while (head) {
+      Node *next = head->next;
+      delete head;
+      head = next;
+    }
+  }
+
  public:
   void push(int item) {
     Node *node = new Node(item);
     Node *last, *next;
+    reclaim::guard guard;
     while (true) {
-      last = tail;  // read tail
+      last = reclaim::protect(0, &tail);  // read tail
       next = last->next;
       if (last == tail) {
         if (next == nullptr) {
@@ -51,8 +64,10 @@ class Queue {
             compareAndExchange(reinterpret_cast<volatile size_t *>(&tail),
                                reinterpret_cast<size_t>(last),
                                reinterpret_cast<size_t>(node));
+            mcas::backoff::success();
             return;
           }
+          mcas::backoff::failure();
         } else {
           compareAndExchange(reinterpret_cast<volatile size_t *>(&tail),
                              reinterpret_cast<size_t>(last),
@@ -63,14 +78,14 @@ class Queue {
   }
 
   int pop() {
-    int c = 0;
+    reclaim::guard guard;
     while (true) {
-      Node *first = head;
+      Node *first = reclaim::protect(0, &head);
       Node *last = tail;
-      Node *next = first->next;
-      if (first == head) {    // are they consistent?
+      Node *next = reclaim::protect(1, &first->next);
+      if (first == head) {    // are they consistent? (next is not retired yet)
         if (first == last) {  // is queue empty or tail falling behind?
-          if (next == NULL || head->value == -1) {  // is queue empty?
+          if (next == NULL || first->value == -1) {  // is queue empty?
             // std::cout << "\nqueue is empty";
             return -1;
           }
@@ -82,8 +97,12 @@ class Queue {
           if (reinterpret_cast<Node *>(
                   compareAndExchange(reinterpret_cast<volatile size_t *>(&head),
                                      reinterpret_cast<size_t>(first),
-                                     reinterpret_cast<size_t>(next))) == first)
+                                     reinterpret_cast<size_t>(next))) == first) {
+            reclaim::retire(first);
+            mcas::backoff::success();
             return value;
+          }
+          mcas::backoff::failure();
         }
       }
     }
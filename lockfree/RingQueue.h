@@ -0,0 +1,95 @@
+// Bounded MPMC queue over an array of cells with per-cell sequence numbers,
+// after Dmitry Vyukov's "Bounded MPMC queue" (1024cores.net). A cell whose
+// sequence equals the enqueue position is free for that position, one whose
+// sequence is one past the dequeue position holds its value; producers and
+// consumers each claim a position with a CAS on their own index, so neither
+// enqueue nor dequeue allocates.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+
+#include "../mcas/backoff.h"
+#include "../padding.h"
+
+namespace lockfree {
+
+class RingQueue {
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    int value;
+  };
+
+  Cell *cells;
+  size_t mask;
+  CACHE_ALIGNED std::atomic<size_t> enqueue_pos;
+  CACHE_ALIGNED std::atomic<size_t> dequeue_pos;
+
+ public:
+  // capacity is rounded up to a power of two
+  explicit RingQueue(size_t capacity) : enqueue_pos(0), dequeue_pos(0) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    cells = new Cell[size];
+    mask = size - 1;
+    for (size_t i = 0; i < size; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  ~RingQueue() { delete[] cells; }
+
+  RingQueue(const RingQueue &) = delete;
+  RingQueue &operator=(const RingQueue &) = delete;
+
+  size_t capacity() const { return mask + 1; }
+
+  // false if the queue is full
+  bool push(int item) {
+    Cell *cell;
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells[pos & mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (dif == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        mcas::backoff::failure();
+      } else if (dif < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    mcas::backoff::success();
+    cell->value = item;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // -1 if the queue is empty
+  int pop() {
+    Cell *cell;
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells[pos & mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (dif == 0) {
+        if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        mcas::backoff::failure();
+      } else if (dif < 0) {
+        return -1;
+      } else {
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    mcas::backoff::success();
+    int value = cell->value;
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return value;
+  }
+};
+
+}  // namespace lockfree
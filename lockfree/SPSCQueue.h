@@ -1,74 +1,111 @@
+// Bounded single-producer single-consumer queue over a ring of slots. Only
+// the producer writes tail and only the consumer writes head, so neither
+// side needs a read-modify-write: a push stores the value, then publishes
+// it by releasing the new tail, and a pop reads the value after acquiring
+// the tail it was published with.
 //
-// Created by kankava on 2020-03-30.
-// Based on code from C++ Concurrency in Action, 2nd Edition
-// listing 7.14
-//
+// Each side also keeps a private copy of the other side's index and reloads
+// the shared one only when the copy says the ring is full (producer) or
+// empty (consumer), so while the ring is neither the two sides touch the
+// other's cache line once per lap instead of once per operation. The batch
+// calls move several values per index update.
 
 #pragma once
 
 #include <atomic>
-#include <memory>
+#include <cstddef>
 
+#include "../padding.h"
 
 namespace lockfree {
 
-template<typename T>
-class SPSCQueue
-{
-private:
-  struct node
-  {
-    std::shared_ptr<T> data;
-    node* next;
-    node()
-      : next(nullptr)
-    {}
-  };
-  std::atomic<node*> head;
-  std::atomic<node*> tail;
-  node* pop_head()
-  {
-    node* const old_head = head.load();
-    if (old_head == tail.load()) {
-      return nullptr;
-    }
-    head.store(old_head->next);
-    return old_head;
+template <typename T>
+class SPSCQueue {
+ private:
+  T *slots;
+  size_t mask;
+  /* producer side: its index and its view of the consumer's */
+  CACHE_ALIGNED std::atomic<size_t> tail;
+  size_t cached_head;
+  /* consumer side */
+  CACHE_ALIGNED std::atomic<size_t> head;
+  size_t cached_tail;
+
+  // slots the producer may fill; head is reloaded only when the cached copy
+  // leaves fewer than needed
+  size_t free_slots(size_t t, size_t needed) {
+    size_t known = mask + 1 - (t - cached_head);
+    if (known >= needed) return known;
+    cached_head = head.load(std::memory_order_acquire);
+    return mask + 1 - (t - cached_head);
+  }
+
+  // values the consumer may take; tail is reloaded only when the cached copy
+  // holds fewer than needed
+  size_t ready(size_t h, size_t needed) {
+    size_t known = cached_tail - h;
+    if (known >= needed) return known;
+    cached_tail = tail.load(std::memory_order_acquire);
+    return cached_tail - h;
+  }
+
+ public:
+  // capacity is rounded up to a power of two
+  explicit SPSCQueue(size_t capacity) : tail(0), cached_head(0), head(0), cached_tail(0) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    slots = new T[size];
+    mask = size - 1;
+  }
+
+  ~SPSCQueue() { delete[] slots; }
+
+  SPSCQueue(const SPSCQueue &) = delete;
+  SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+  size_t capacity() const { return mask + 1; }
+
+  // producer only; a lower bound on the free slots, re-read from the
+  // consumer only when the cached one is below needed
+  size_t room(size_t needed) { return free_slots(tail.load(std::memory_order_relaxed), needed); }
+
+  // producer only; false if the queue is full
+  bool push(const T &item) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (free_slots(t, 1) == 0) return false;
+    slots[t & mask] = item;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
   }
 
-public:
-  SPSCQueue()
-    : head(new node)
-    , tail(head.load())
-  {}
-  SPSCQueue(const SPSCQueue& other) = delete;
-  SPSCQueue& operator=(const SPSCQueue& other) = delete;
-  ~SPSCQueue()
-  {
-    while (node* const old_head = head.load()) {
-      head.store(old_head->next);
-      delete old_head;
-    }
+  // producer only; pushes the first of n items that fit, returns how many
+  size_t push(const T *items, size_t n) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t room = free_slots(t, n);
+    if (n > room) n = room;
+    for (size_t i = 0; i < n; i++) slots[(t + i) & mask] = items[i];
+    if (n) tail.store(t + n, std::memory_order_release);
+    return n;
   }
-  std::shared_ptr<T> pop()
-  {
-    node* old_head = pop_head();
-    if (!old_head) {
-      return std::shared_ptr<T>();
-    }
-    std::shared_ptr<T> const res(old_head->data);
-    delete old_head;
-    return res;
+
+  // consumer only; false if the queue is empty
+  bool pop(T &item) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (ready(h, 1) == 0) return false;
+    item = slots[h & mask];
+    head.store(h + 1, std::memory_order_release);
+    return true;
   }
-  void push(T new_value)
-  {
-    std::shared_ptr<T> new_data(std::make_shared<T>(new_value));
-    node* p = new node;
-    node* const old_tail = tail.load();
-    old_tail->data.swap(new_data);
-    old_tail->next = p;
-    tail.store(p);
+
+  // consumer only; pops up to n items into out, returns how many
+  size_t pop(T *out, size_t n) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t available = ready(h, n);
+    if (n > available) n = available;
+    for (size_t i = 0; i < n; i++) out[i] = slots[(h + i) & mask];
+    if (n) head.store(h + n, std::memory_order_release);
+    return n;
   }
 };
 
-} // namespace lockfree
+}  // namespace lockfree
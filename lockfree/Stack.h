@@ -2,6 +2,9 @@
 // Listing 7.9
 
 #pragma once
+
+#include "../mcas/backoff.h"
+
 namespace lockfree {
 template <typename T>
 class Stack {
@@ -18,14 +21,16 @@ class Stack {
     std::shared_ptr<node> const new_node = std::make_shared<node>(data);
     new_node->next = std::atomic_load(&head);
     while (!std::atomic_compare_exchange_weak(&head, &new_node->next, new_node))
-      ;
+      mcas::backoff::failure();
+    mcas::backoff::success();
   }
 
   std::shared_ptr<T> pop() {
     std::shared_ptr<node> old_head = std::atomic_load(&head);
     while (old_head && !std::atomic_compare_exchange_weak(
                            &head, &old_head, std::atomic_load(&old_head->next)))
-      ;
+      mcas::backoff::failure();
+    if (old_head) mcas::backoff::success();
     if (old_head) {
       std::atomic_store(&old_head->next, std::shared_ptr<node>());
       return old_head->data;
@@ -1,4 +1,6 @@
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
 
 #ifdef ENABLE_PARSEC_HOOKS
 #include <hooks.h>
@@ -6,8 +8,138 @@
 
 #include "benchmarks.h"
 #include "configuration.h"
+#include "mcas/stats.h"
+#include "reclaim/reclaim.h"
+#include "results.h"
 #include "cxxopts.hpp"
 
+// "1,2,4,8"
+static bool parse_thread_list(const std::string& list, std::vector<unsigned int>& threads) {
+  std::istringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    int n = std::atoi(item.c_str());
+    if (n < 1) return false;
+    threads.push_back(n);
+  }
+  return !threads.empty();
+}
+
+// "first:last" steps by one, "first:last:+k" by k, "first:last:xk" multiplies by k
+static bool parse_thread_range(const std::string& range, std::vector<unsigned int>& threads) {
+  int first = 0, last = 0, step = 1;
+  char op = '+';
+  auto colon = range.find(':');
+  if (colon == std::string::npos) return false;
+  first = std::atoi(range.substr(0, colon).c_str());
+  auto second = range.find(':', colon + 1);
+  last = std::atoi(range.substr(colon + 1, second - colon - 1).c_str());
+  if (second != std::string::npos) {
+    std::string s = range.substr(second + 1);
+    if (!s.empty() && (s[0] == 'x' || s[0] == '+')) {
+      op = s[0];
+      s = s.substr(1);
+    }
+    step = std::atoi(s.c_str());
+  }
+  if (first < 1 || last < first || step < 1 || (op == 'x' && step < 2)) return false;
+  for (int n = first; n <= last; n = op == 'x' ? n * step : n + step) threads.push_back(n);
+  return true;
+}
+
+// "insert:remove:lookup" weights, e.g. 5:5:90
+static bool parse_mix(const std::string& mix, Configuration::OpMix& weights) {
+  char sep1 = 0, sep2 = 0;
+  std::istringstream in(mix);
+  int insert = -1, remove = -1, lookup = -1;
+  in >> insert >> sep1 >> remove >> sep2 >> lookup;
+  if (!in || !in.eof() || sep1 != ':' || sep2 != ':') return false;
+  if (insert < 0 || remove < 0 || lookup < 0 || insert + remove + lookup == 0) return false;
+  weights = {static_cast<unsigned int>(insert), static_cast<unsigned int>(remove),
+             static_cast<unsigned int>(lookup)};
+  return true;
+}
+
+// "uniform", "zipf[:theta]", "hotspot[:ops:keys]" or "sequential"
+static bool parse_distribution(const std::string& dist, Configuration& conf) {
+  std::istringstream in(dist);
+  std::string name;
+  std::getline(in, name, ':');
+  std::vector<double> params;
+  std::string param;
+  while (std::getline(in, param, ':')) {
+    char* end = nullptr;
+    params.push_back(std::strtod(param.c_str(), &end));
+    if (param.empty() || *end != '\0') return false;
+  }
+
+  if (name == "uniform" && params.empty()) {
+    conf.key_dist = Configuration::KeyDistribution::UNIFORM;
+  } else if (name == "sequential" && params.empty()) {
+    conf.key_dist = Configuration::KeyDistribution::SEQUENTIAL;
+  } else if (name == "zipf" && params.size() <= 1) {
+    conf.key_dist = Configuration::KeyDistribution::ZIPF;
+    if (!params.empty()) conf.zipf_theta = params[0];
+    if (conf.zipf_theta < 0) return false;
+  } else if (name == "hotspot" && (params.empty() || params.size() == 2)) {
+    conf.key_dist = Configuration::KeyDistribution::HOTSPOT;
+    if (!params.empty()) {
+      conf.hotspot_ops = params[0];
+      conf.hotspot_keys = params[1];
+    }
+    if (conf.hotspot_ops < 0 || conf.hotspot_ops > 1) return false;
+    if (conf.hotspot_keys <= 0 || conf.hotspot_keys > 1) return false;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// "none", "exp[:min:max]" or "adaptive[:min:max]", bounds in spins
+static bool parse_backoff(const std::string& backoff, Configuration& conf) {
+  std::istringstream in(backoff);
+  std::string name;
+  std::getline(in, name, ':');
+  std::vector<long> params;
+  std::string param;
+  while (std::getline(in, param, ':')) {
+    char* end = nullptr;
+    params.push_back(std::strtol(param.c_str(), &end, 10));
+    if (param.empty() || *end != '\0') return false;
+  }
+
+  if (name == "none" && params.empty()) {
+    conf.backoff = Configuration::BackoffPolicy::BACKOFF_NONE;
+  } else if ((name == "exp" || name == "adaptive") && (params.empty() || params.size() == 2)) {
+    conf.backoff = name == "exp" ? Configuration::BackoffPolicy::BACKOFF_EXPONENTIAL
+                                 : Configuration::BackoffPolicy::BACKOFF_ADAPTIVE;
+    if (!params.empty()) {
+      if (params[0] < 1 || params[1] < params[0]) return false;
+      conf.backoff_min = params[0];
+      conf.backoff_max = params[1];
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// "name=code,..." with hexadecimal raw event codes, e.g. hitm=0x04d2
+static bool parse_raw_events(const std::string& list, Configuration& conf) {
+  std::istringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    auto eq = item.find('=');
+    if (eq == std::string::npos || eq == 0) return false;
+    char* end = nullptr;
+    std::string code = item.substr(eq + 1);
+    uint64_t value = std::strtoull(code.c_str(), &end, 16);
+    if (code.empty() || *end != '\0') return false;
+    conf.perf_raw_events.push_back({item.substr(0, eq), value});
+  }
+  return true;
+}
+
 int main(int argc, char *argv[])
 {
 #ifdef ENABLE_PARSEC_HOOKS
@@ -19,10 +151,36 @@ int main(int argc, char *argv[])
 
   options.add_options()
       ("n,nthreads", "Number of threads", cxxopts::value<int>()->default_value("1"))
-      ("i,iter", "Number of iterations", cxxopts::value<int>()->default_value("1"))
+      ("threads", "Sweep these thread counts, e.g. 1,2,4,8", cxxopts::value<std::string>())
+      ("threads-range", "Sweep a range of thread counts: first:last[:+step|:xfactor], e.g. 1:64:x2", cxxopts::value<std::string>())
+      ("i,iter", "Number of runs of each phase, each on a freshly prefilled structure", cxxopts::value<int>()->default_value("1"))
       ("o,ops", "Number of operations", cxxopts::value<int>()->default_value("100"))
-      ("s,sync", "Synchronization type: lock, lockfree, lockfree-mcas", cxxopts::value<std::string>())
-      ("a,algorithm", "Benchmark algorithm: mwobject, arrayswap, stack, queue, deque, sorted-list, hashmap, bst", cxxopts::value<std::string>())
+      ("s,sync", "Synchronization type: lock, lockfree, lockfree-mcas, a comma-separated list or all (these three); lockfree-ring and lockfree-mcas-ring (bounded array queues) and lockfree-faa (fetch-and-add array queue) only run -a queue", cxxopts::value<std::string>())
+      ("a,algorithm", "Benchmark algorithm: mwobject, arrayswap, stack, queue, deque, sorted-list, hashmap, bst, spsc (one producer, one consumer; -s lockfree only)", cxxopts::value<std::string>())
+      ("key-range", "Keys (and values) are drawn from [0, key-range)", cxxopts::value<long>()->default_value("256"))
+      ("prefill", "Elements inserted into each structure before a phase", cxxopts::value<long>()->default_value("1024"))
+      ("capacity", "Slots of the bounded ring queues and the spsc ring, rounded up to a power of two (default: twice the prefill, at least 1024)", cxxopts::value<long>()->default_value("0"))
+      ("batch", "Items the spsc producer and consumer move per call", cxxopts::value<int>()->default_value("1"))
+      ("mix", "Run one phase with these insert:remove:lookup weights instead of read/update/mixed; stack, queue and deque use the insert:remove share", cxxopts::value<std::string>())
+      ("dist", "Key distribution: uniform, zipf[:theta], hotspot[:ops:keys] (e.g. hotspot:0.9:0.1, 90% of operations on 10% of the keys), sequential", cxxopts::value<std::string>()->default_value("uniform"))
+      ("w,width", "Words updated per mwobject operation (1-16)", cxxopts::value<int>()->default_value("4"))
+      ("spread", "mwobject word placement: packed, line (one per cache line), page (one per page)", cxxopts::value<std::string>()->default_value("packed"))
+      ("pregen", "Generate each thread's random stream before the clock starts", cxxopts::value<bool>()->default_value("false"))
+      ("duration", "Run each phase for this many seconds instead of a fixed number of operations", cxxopts::value<double>()->default_value("0"))
+      ("warmup", "Seconds to run before counting operations in a --duration run", cxxopts::value<double>()->default_value("0"))
+      ("latency", "Time every Nth operation into per-operation latency histograms (0 disables)", cxxopts::value<int>()->default_value("0"))
+      ("format", "Result format: text, json, csv", cxxopts::value<std::string>()->default_value("text"))
+      ("output", "Write json/csv results to this file instead of stdout", cxxopts::value<std::string>()->default_value(""))
+      ("perf", "Count cycles, instructions, LLC, L1D and branch misses per operation with perf_event_open", cxxopts::value<bool>()->default_value("false"))
+      ("perf-raw", "Extra raw PMU events for --perf as name=hexcode,..., e.g. an offcore or HITM event such as hitm=0x04d2 on Skylake", cxxopts::value<std::string>())
+      ("heatmap", "Sample every Nth failed MCAS and print the hottest words and cache lines per phase (needs a build with MCAS_STATS)", cxxopts::value<int>()->default_value("0"))
+      ("heatmap-top", "Hot words and cache lines printed by --heatmap", cxxopts::value<int>()->default_value("10"))
+      ("backoff", "Wait after a failed MCAS/CAS before retrying: none, exp[:min:max] (doubling window), adaptive[:min:max] (window follows the failure rate); bounds in spins", cxxopts::value<std::string>()->default_value("none"))
+      ("pause", "Spin on PAUSE while backing off", cxxopts::value<bool>()->default_value("false"))
+      ("reclaim", "How the lockfree structures free unlinked nodes: none (leak), epoch, hazard (hazard pointers, bounded garbage; the bst uses epochs either way)", cxxopts::value<std::string>()->default_value("epoch"))
+      ("alloc", "Node allocator of the lock deque, sorted-list and hashmap and the lockfree-mcas deque and sorted-list: heap (new/delete), pool (per-thread cache-line blocks)", cxxopts::value<std::string>()->default_value("heap"))
+      ("roi", "Region of interest marker around each measured phase: none, parsec (gem5 builds), perf (perf stat --control fd:$PERF_CTL_FD,$PERF_ACK_FD), trace", cxxopts::value<std::string>())
+      ("roi-phases", "Phases that are regions of interest, e.g. prefill,mixed (default: every phase but prefill)", cxxopts::value<std::string>())
       ("d,debug", "Enable debugging", cxxopts::value<bool>()->default_value("false"))
       ("h,help", "Print usage")
       ;
@@ -42,14 +200,39 @@ int main(int argc, char *argv[])
   conf.n_threads = result["nthreads"].as<int>();
   conf.n_iter = result["iter"].as<int>();
   conf.n_ops = result["ops"].as<int>();
+  conf.pregenerate = result["pregen"].as<bool>();
+  conf.duration = result["duration"].as<double>();
+  conf.warmup = result["warmup"].as<double>();
+  conf.latency_sample = result["latency"].as<int>();
   conf.sync_type = Configuration::SyncType::SYNC_UNDEF;
   conf.benchmarking_algorithm = Configuration::BenchmarkAlgorithm::ALG_UNDEF;
 
   if (result.count("sync")) {
-    std::string sync_type = result["sync"].as<std::string>();
-    if (sync_type == "lock") conf.sync_type = Configuration::SyncType::LOCK;
-    if (sync_type == "lockfree") conf.sync_type = Configuration::SyncType::LOCKFREE;
-    if (sync_type == "lockfree-mcas") conf.sync_type = Configuration::SyncType::LOCKFREE_MCAS;
+    std::istringstream sync_types(result["sync"].as<std::string>());
+    std::string sync_type;
+    while (std::getline(sync_types, sync_type, ',')) {
+      if (sync_type == "all") {
+        conf.sync_types.push_back(Configuration::SyncType::LOCK);
+        conf.sync_types.push_back(Configuration::SyncType::LOCKFREE);
+        conf.sync_types.push_back(Configuration::SyncType::LOCKFREE_MCAS);
+      } else if (sync_type == "lock") {
+        conf.sync_types.push_back(Configuration::SyncType::LOCK);
+      } else if (sync_type == "lockfree") {
+        conf.sync_types.push_back(Configuration::SyncType::LOCKFREE);
+      } else if (sync_type == "lockfree-mcas") {
+        conf.sync_types.push_back(Configuration::SyncType::LOCKFREE_MCAS);
+      } else if (sync_type == "lockfree-ring") {
+        conf.sync_types.push_back(Configuration::SyncType::LOCKFREE_RING);
+      } else if (sync_type == "lockfree-mcas-ring") {
+        conf.sync_types.push_back(Configuration::SyncType::LOCKFREE_MCAS_RING);
+      } else if (sync_type == "lockfree-faa") {
+        conf.sync_types.push_back(Configuration::SyncType::LOCKFREE_FAA);
+      } else {
+        conf.sync_types.clear();
+        break;
+      }
+    }
+    if (!conf.sync_types.empty()) conf.sync_type = conf.sync_types.front();
   }
 
   if (conf.sync_type == Configuration::SyncType::SYNC_UNDEF) {
@@ -68,6 +251,7 @@ int main(int argc, char *argv[])
     if (algorithm == "sorted-list") conf.benchmarking_algorithm = Configuration::BenchmarkAlgorithm::SORTEDLIST;
     if (algorithm == "hashmap") conf.benchmarking_algorithm = Configuration::BenchmarkAlgorithm::HASHMAP;
     if (algorithm == "bst") conf.benchmarking_algorithm = Configuration::BenchmarkAlgorithm::BST;
+    if (algorithm == "spsc") conf.benchmarking_algorithm = Configuration::BenchmarkAlgorithm::SPSC;
   }
 
   if (conf.benchmarking_algorithm == Configuration::BenchmarkAlgorithm::ALG_UNDEF) {
@@ -76,19 +260,189 @@ int main(int argc, char *argv[])
     return 0;
   }
 
+  if (result.count("threads") && !parse_thread_list(result["threads"].as<std::string>(), conf.thread_sweep)) {
+    std::cout << "threads must be a comma-separated list of positive counts" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+  if (result.count("threads-range") && !parse_thread_range(result["threads-range"].as<std::string>(), conf.thread_sweep)) {
+    std::cout << "threads-range must be first:last[:+step|:xfactor]" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  if (result["key-range"].as<long>() < 1 || result["prefill"].as<long>() < 0 ||
+      result["capacity"].as<long>() < 0 || result["batch"].as<int>() < 1) {
+    std::cout << "key-range and batch must be positive, prefill and capacity must not be negative" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+  conf.key_range = result["key-range"].as<long>();
+  conf.prefill = result["prefill"].as<long>();
+  conf.queue_capacity = result["capacity"].as<long>();
+  conf.spsc_batch = result["batch"].as<int>();
+
+  if (result.count("mix") && !parse_mix(result["mix"].as<std::string>(), conf.mix)) {
+    std::cout << "mix must be insert:remove:lookup weights, e.g. 5:5:90" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  if (!parse_distribution(result["dist"].as<std::string>(), conf)) {
+    std::cout << "dist is not defined" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+  // skewed distributions keep an 8 byte alias table entry per key
+  if ((conf.key_dist == Configuration::KeyDistribution::ZIPF ||
+       conf.key_dist == Configuration::KeyDistribution::HOTSPOT) &&
+      conf.key_range > (1ul << 26)) {
+    std::cout << "zipf and hotspot support a key-range of at most " << (1ul << 26) << std::endl;
+    return 0;
+  }
+
+  conf.mwobject_width = result["width"].as<int>();
+  if (conf.mwobject_width < 1 || conf.mwobject_width > 16) {
+    std::cout << "width must be between 1 and 16" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  std::string spread = result["spread"].as<std::string>();
+  if (spread == "packed") conf.mwobject_spread = Configuration::MWObjectSpread::PACKED;
+  else if (spread == "line") conf.mwobject_spread = Configuration::MWObjectSpread::LINE;
+  else if (spread == "page") conf.mwobject_spread = Configuration::MWObjectSpread::PAGE;
+  else {
+    std::cout << "spread is not defined" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  std::string format = result["format"].as<std::string>();
+  if (format == "text") conf.output_format = Configuration::OutputFormat::TEXT;
+  else if (format == "json") conf.output_format = Configuration::OutputFormat::JSON;
+  else if (format == "csv") conf.output_format = Configuration::OutputFormat::CSV;
+  else {
+    std::cout << "format is not defined" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+  conf.output_file = result["output"].as<std::string>();
+
+  conf.perf_counters = result["perf"].as<bool>();
+  if (result.count("perf-raw") && !parse_raw_events(result["perf-raw"].as<std::string>(), conf)) {
+    std::cout << "perf-raw must be name=hexcode pairs, e.g. hitm=0x04d2" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  if (result["heatmap"].as<int>() < 0 || result["heatmap-top"].as<int>() < 1) {
+    std::cout << "heatmap must not be negative and heatmap-top must be positive" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+  conf.heatmap_sample = result["heatmap"].as<int>();
+  conf.heatmap_top = result["heatmap-top"].as<int>();
+  if (conf.heatmap_sample && !mcas::stats::ENABLED) {
+    std::cout << "heatmap needs a build with MCAS_STATS (cmake -DMCAS_STATS=ON)" << std::endl;
+    return 0;
+  }
+
+  if (!parse_backoff(result["backoff"].as<std::string>(), conf)) {
+    std::cout << "backoff must be none, exp[:min:max] or adaptive[:min:max]" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+  conf.backoff_pause = result["pause"].as<bool>();
+
+  std::string reclaim = result["reclaim"].as<std::string>();
+  if (reclaim == "none") conf.reclaim = Configuration::ReclaimScheme::RECLAIM_NONE;
+  else if (reclaim == "epoch") conf.reclaim = Configuration::ReclaimScheme::RECLAIM_EPOCH;
+  else if (reclaim == "hazard") conf.reclaim = Configuration::ReclaimScheme::RECLAIM_HAZARD;
+  else {
+    std::cout << "reclaim must be none, epoch or hazard" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+  reclaim::scheme() = static_cast<reclaim::Scheme>(conf.reclaim);
+
+  std::string allocator = result["alloc"].as<std::string>();
+  if (allocator == "heap") conf.node_allocator = Configuration::NodeAllocator::ALLOC_HEAP;
+  else if (allocator == "pool") conf.node_allocator = Configuration::NodeAllocator::ALLOC_POOL;
+  else {
+    std::cout << "alloc must be heap or pool" << std::endl;
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  if (result.count("roi")) {
+    std::string roi = result["roi"].as<std::string>();
+    if (roi == "none") conf.roi_backend = Configuration::RoiBackend::ROI_NONE;
+#ifdef ENABLE_PARSEC_HOOKS
+    else if (roi == "parsec") conf.roi_backend = Configuration::RoiBackend::ROI_PARSEC;
+#endif
+    else if (roi == "perf") conf.roi_backend = Configuration::RoiBackend::ROI_PERF;
+    else if (roi == "trace") conf.roi_backend = Configuration::RoiBackend::ROI_TRACE;
+    else {
+      std::cout << "roi is not defined (parsec needs a build with PARSEC hooks)" << std::endl;
+      std::cout << options.help() << std::endl;
+      return 0;
+    }
+  }
+  if (result.count("roi-phases")) {
+    std::istringstream phases(result["roi-phases"].as<std::string>());
+    std::string phase;
+    while (std::getline(phases, phase, ',')) conf.roi_phases.push_back(phase);
+  }
+
+  if (!result_writer::instance().open(conf)) {
+    std::cout << "cannot open output file " << conf.output_file << std::endl;
+    return 0;
+  }
+
   if (conf.debug) {
     std::cout << "configuration:" << std::endl
               << "debug = " << conf.debug << std::endl
               << "n_iter = " << conf.n_iter << std::endl
               << "n_threads = " << conf.n_threads << std::endl
+              << "thread_sweep =";
+    for (auto threads : conf.thread_sweep) std::cout << " " << threads;
+    std::cout << std::endl
               << "n_ops = " << conf.n_ops << std::endl
+              << "pregenerate = " << conf.pregenerate << std::endl
+              << "duration = " << conf.duration << std::endl
+              << "warmup = " << conf.warmup << std::endl
+              << "latency_sample = " << conf.latency_sample << std::endl
               << "type = " << conf.sync_type << std::endl
-              << "algorithm = " << conf.benchmarking_algorithm << std::endl;
+              << "algorithm = " << conf.benchmarking_algorithm << std::endl
+              << "key_range = " << conf.key_range << std::endl
+              << "prefill = " << conf.prefill << std::endl
+              << "queue_capacity = " << conf.queue_capacity << std::endl
+              << "spsc_batch = " << conf.spsc_batch << std::endl
+              << "key_dist = " << conf.key_dist << " (theta " << conf.zipf_theta
+              << ", hotspot " << conf.hotspot_ops << ":" << conf.hotspot_keys << ")" << std::endl
+              << "mix = " << conf.mix.insert << ":" << conf.mix.remove << ":" << conf.mix.lookup << std::endl
+              << "mwobject_width = " << conf.mwobject_width << std::endl
+              << "mwobject_spread = " << conf.mwobject_spread << std::endl
+              << "output_format = " << conf.output_format << std::endl
+              << "output_file = " << conf.output_file << std::endl
+              << "perf_counters = " << conf.perf_counters << std::endl
+              << "heatmap_sample = " << conf.heatmap_sample << std::endl
+              << "heatmap_top = " << conf.heatmap_top << std::endl
+              << "backoff = " << conf.backoff << " (" << conf.backoff_min << ":" << conf.backoff_max
+              << ", pause " << conf.backoff_pause << ")" << std::endl
+              << "reclaim = " << conf.reclaim << std::endl
+              << "node_allocator = " << conf.node_allocator << std::endl
+              << "roi_backend = " << conf.roi_backend << std::endl
+              << "roi_phases =";
+    for (auto& phase : conf.roi_phases) std::cout << " " << phase;
+    std::cout << std::endl;
   }
 
-  std::cout << "MCAS Benchmarks started" << std::endl;
+  console() << "MCAS Benchmarks started" << std::endl;
   run_benchmarks(conf);
-  std::cout << "MCAS Benchmarks finished" << std::endl;
+  console() << "MCAS Benchmarks finished" << std::endl;
+  result_writer::instance().close();
 
 #ifdef ENABLE_PARSEC_HOOKS
   __parsec_bench_end();
@@ -0,0 +1,106 @@
+// Contention management for retry loops. A failed MCAS (or CAS) is followed
+// by a short randomized wait before the caller retries, so threads that
+// collided do not collide again straight away:
+//  - NONE:        retry immediately, the structures' original behaviour,
+//  - EXPONENTIAL: the wait window doubles with every failure in a row and
+//                 drops back to the minimum on success,
+//  - ADAPTIVE:    the window follows the thread's recent failure rate.
+// The wait spins on PAUSE (YIELD on ARM) if enabled, on a compiler barrier
+// otherwise. The policy is global and chosen at run time; the window and
+// failure rate are per thread.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace mcas {
+namespace backoff {
+
+enum Policy {
+  NONE,
+  EXPONENTIAL,
+  ADAPTIVE
+};
+
+struct settings {
+  Policy policy;
+  bool pause;
+  unsigned int min_spins;
+  unsigned int max_spins;
+};
+
+inline settings& current() {
+  static settings s = {NONE, false, 16, 4096};
+  return s;
+}
+
+struct thread_state {
+  unsigned int window;  // exponential: upper bound of the next wait
+  uint32_t rate;        // adaptive: failure rate in 1/65536
+  uint64_t random;
+};
+
+inline thread_state& local() {
+  thread_local thread_state s = {0, 0, reinterpret_cast<uintptr_t>(&s) | 1};
+  return s;
+}
+
+inline void reset() {
+  local().window = current().min_spins;
+  local().rate = 0;
+}
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  __asm__ volatile("yield" ::: "memory");
+#else
+  __asm__ volatile("" ::: "memory");
+#endif
+}
+
+inline void spin(unsigned int n, bool pause) {
+  for (unsigned int i = 0; i < n; i++) {
+    if (pause) cpu_relax();
+    else __asm__ volatile("" ::: "memory");
+  }
+}
+
+// xorshift64, cheap enough to run on every failure
+inline unsigned int random_below(thread_state& s, unsigned int bound) {
+  s.random ^= s.random << 13;
+  s.random ^= s.random >> 7;
+  s.random ^= s.random << 17;
+  return bound ? s.random % bound : 0;
+}
+
+// call after a failed attempt, before retrying
+inline void failure() {
+  const settings& c = current();
+  if (c.policy == NONE) return;
+  thread_state& s = local();
+  unsigned int window;
+  if (c.policy == EXPONENTIAL) {
+    if (s.window < c.min_spins) s.window = c.min_spins;
+    window = s.window;
+    s.window = s.window < c.max_spins / 2 ? s.window * 2 : c.max_spins;
+  } else {
+    s.rate += (65536 - s.rate) >> 4;
+    window = c.min_spins + static_cast<unsigned int>(
+                               static_cast<uint64_t>(c.max_spins - c.min_spins) * s.rate >> 16);
+  }
+  spin(random_below(s, window) + 1, c.pause);
+}
+
+// call after a successful attempt
+inline void success() {
+  const settings& c = current();
+  if (c.policy == NONE) return;
+  thread_state& s = local();
+  if (c.policy == EXPONENTIAL) s.window = c.min_spins;
+  else s.rate -= s.rate >> 4;
+}
+
+}  // namespace backoff
+}  // namespace mcas
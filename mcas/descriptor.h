@@ -0,0 +1,308 @@
+// Lock-free software MCAS built from RDCSS and single-word CAS as described
+// in Harris, Fraser and Pratt 2002 "A practical multi-word compare-and-swap
+// operation". Descriptors are owned per thread and reused under a sequence
+// number (Arbel-Raviv and Brown 2017 "Reuse, don't recycle"), so an
+// operation never allocates and stale helpers can never act on a reused
+// descriptor.
+//
+// Restrictions on the words handed to this backend:
+//  - the two top bits are reserved for descriptor tags, so values must stay
+//    below 2^62 (true for user-space pointers and non-negative counters);
+//  - while a word can be targeted concurrently it has to be read through
+//    mcas_read(), a plain load may observe a descriptor.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "word.h"
+
+namespace mcas {
+namespace descriptor {
+
+const int TID_BITS = 10;
+const int MAX_THREADS = 1 << TID_BITS;
+
+const uint64_t KCAS_TAG = 1ull << 63;
+const uint64_t RDCSS_TAG = 1ull << 62;
+const uint64_t TAG_MASK = KCAS_TAG | RDCSS_TAG;
+const uint64_t TID_MASK = (1ull << TID_BITS) - 1;
+const uint64_t SEQ_MASK = ~TAG_MASK >> TID_BITS;
+
+enum State : uint64_t { UNDECIDED = 0, SUCCEEDED = 1, FAILED = 2 };
+
+struct alignas(64) KcasDescriptor {
+  uint64_t status;  // (seq << 2) | state
+  uint64_t n;
+  Word entries[MAX_WORDS];
+};
+
+struct alignas(64) RdcssDescriptor {
+  uint64_t seq;
+  uint64_t* status_addr;
+  uint64_t status_expected;
+  uint64_t* addr;
+  uint64_t old_val;
+  uint64_t new_val;
+};
+
+struct KcasSnapshot {
+  uint64_t n;
+  Word entries[MAX_WORDS];
+};
+
+struct RdcssSnapshot {
+  uint64_t* status_addr;
+  uint64_t status_expected;
+  uint64_t* addr;
+  uint64_t old_val;
+  uint64_t new_val;
+};
+
+inline bool is_kcas(uint64_t val) { return val & KCAS_TAG; }
+inline bool is_rdcss(uint64_t val) { return val & RDCSS_TAG; }
+
+inline uint64_t make_ptr(uint64_t tag, int tid, uint64_t seq) {
+  return tag | (seq << TID_BITS) | static_cast<uint64_t>(tid);
+}
+inline int ptr_tid(uint64_t ptr) { return static_cast<int>(ptr & TID_MASK); }
+inline uint64_t ptr_seq(uint64_t ptr) { return (ptr & ~TAG_MASK) >> TID_BITS; }
+
+inline uint64_t make_status(uint64_t seq, uint64_t state) {
+  return (seq << 2) | state;
+}
+inline uint64_t status_seq(uint64_t status) { return status >> 2; }
+inline uint64_t status_state(uint64_t status) { return status & 3; }
+
+inline uint64_t load(uint64_t* addr) {
+  return __atomic_load_n(addr, __ATOMIC_ACQUIRE);
+}
+
+inline bool cas_word(uint64_t* addr, uint64_t& expected, uint64_t desired) {
+  return __atomic_compare_exchange_n(addr, &expected, desired, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+inline KcasDescriptor& kcas_descriptor(int tid) {
+  static KcasDescriptor descriptors[MAX_THREADS];
+  return descriptors[tid];
+}
+
+inline RdcssDescriptor& rdcss_descriptor(int tid) {
+  static RdcssDescriptor descriptors[MAX_THREADS];
+  return descriptors[tid];
+}
+
+// Descriptor slots are leased to live threads; the benchmark harness spawns
+// fresh workers for every phase, so a slot is returned when its thread exits.
+// The sequence numbers stay in the descriptor and keep growing across leases.
+class ThreadSlot {
+ public:
+  ThreadSlot() : tid(acquire()) {}
+  ~ThreadSlot() { slots()[tid].store(false, std::memory_order_release); }
+
+  const int tid;
+
+ private:
+  static std::atomic<bool>* slots() {
+    static std::atomic<bool> leased[MAX_THREADS];
+    return leased;
+  }
+
+  static int acquire() {
+    while (true) {
+      for (int i = 0; i < MAX_THREADS; i++) {
+        bool expected = false;
+        if (!slots()[i].load(std::memory_order_relaxed) &&
+            slots()[i].compare_exchange_strong(expected, true,
+                                               std::memory_order_acquire))
+          return i;
+      }
+    }
+  }
+};
+
+inline int thread_id() {
+  static thread_local ThreadSlot slot;
+  return slot.tid;
+}
+
+// Copies the descriptor behind ptr; returns false if the descriptor has
+// already been reused, i.e. the operation ptr refers to has completed.
+inline bool rdcss_snapshot(uint64_t ptr, RdcssSnapshot& s) {
+  RdcssDescriptor& d = rdcss_descriptor(ptr_tid(ptr));
+  s.status_addr = __atomic_load_n(&d.status_addr, __ATOMIC_RELAXED);
+  s.status_expected = __atomic_load_n(&d.status_expected, __ATOMIC_RELAXED);
+  s.addr = __atomic_load_n(&d.addr, __ATOMIC_RELAXED);
+  s.old_val = __atomic_load_n(&d.old_val, __ATOMIC_RELAXED);
+  s.new_val = __atomic_load_n(&d.new_val, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&d.seq, __ATOMIC_RELAXED) == ptr_seq(ptr);
+}
+
+inline void rdcss_complete(const RdcssSnapshot& s, uint64_t ptr) {
+  uint64_t status = load(s.status_addr);
+  uint64_t expected = ptr;
+  cas_word(s.addr, expected,
+           status == s.status_expected ? s.new_val : s.old_val);
+}
+
+inline void rdcss_help(uint64_t ptr) {
+  RdcssSnapshot s;
+  if (rdcss_snapshot(ptr, s)) rdcss_complete(s, ptr);
+}
+
+// Installs new_val at addr if addr holds old_val and *status_addr holds
+// status_expected. Returns the value found at addr.
+inline uint64_t rdcss(int tid, uint64_t* status_addr, uint64_t status_expected,
+                      uint64_t* addr, uint64_t old_val, uint64_t new_val) {
+  RdcssDescriptor& d = rdcss_descriptor(tid);
+  uint64_t seq = (__atomic_load_n(&d.seq, __ATOMIC_RELAXED) + 1) & SEQ_MASK;
+  __atomic_store_n(&d.seq, seq, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&d.status_addr, status_addr, __ATOMIC_RELAXED);
+  __atomic_store_n(&d.status_expected, status_expected, __ATOMIC_RELAXED);
+  __atomic_store_n(&d.addr, addr, __ATOMIC_RELAXED);
+  __atomic_store_n(&d.old_val, old_val, __ATOMIC_RELAXED);
+  __atomic_store_n(&d.new_val, new_val, __ATOMIC_RELAXED);
+
+  RdcssSnapshot s{status_addr, status_expected, addr, old_val, new_val};
+  uint64_t ptr = make_ptr(RDCSS_TAG, tid, seq);
+  while (true) {
+    uint64_t found = old_val;
+    if (cas_word(addr, found, ptr)) {
+      rdcss_complete(s, ptr);
+      return old_val;
+    }
+    if (!is_rdcss(found)) return found;
+    rdcss_help(found);
+  }
+}
+
+inline bool kcas_snapshot(uint64_t ptr, KcasSnapshot& s) {
+  KcasDescriptor& d = kcas_descriptor(ptr_tid(ptr));
+  s.n = __atomic_load_n(&d.n, __ATOMIC_RELAXED);
+  if (s.n > MAX_WORDS) s.n = MAX_WORDS;  // torn read, rejected below
+  for (uint64_t i = 0; i < s.n; i++) {
+    s.entries[i].addr = __atomic_load_n(&d.entries[i].addr, __ATOMIC_RELAXED);
+    s.entries[i].old_val =
+        __atomic_load_n(&d.entries[i].old_val, __ATOMIC_RELAXED);
+    s.entries[i].new_val =
+        __atomic_load_n(&d.entries[i].new_val, __ATOMIC_RELAXED);
+  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return status_seq(__atomic_load_n(&d.status, __ATOMIC_RELAXED)) ==
+         ptr_seq(ptr);
+}
+
+inline bool kcas_help(int tid, uint64_t ptr, const KcasSnapshot& s);
+
+inline void kcas_help(int tid, uint64_t ptr) {
+  KcasSnapshot s;
+  if (kcas_snapshot(ptr, s)) kcas_help(tid, ptr, s);
+}
+
+inline bool kcas_help(int tid, uint64_t ptr, const KcasSnapshot& s) {
+  KcasDescriptor& d = kcas_descriptor(ptr_tid(ptr));
+  uint64_t seq = ptr_seq(ptr);
+  uint64_t undecided = make_status(seq, UNDECIDED);
+  uint64_t state = SUCCEEDED;
+
+  // phase 1: acquire every word in address order
+  for (uint64_t i = 0; i < s.n && state == SUCCEEDED; i++) {
+    while (load(&d.status) == undecided) {
+      uint64_t found = rdcss(tid, &d.status, undecided, s.entries[i].addr,
+                             s.entries[i].old_val, ptr);
+      if (is_kcas(found) && found != ptr) {
+        kcas_help(tid, found);
+        continue;
+      }
+      if (found != s.entries[i].old_val && found != ptr) state = FAILED;
+      break;
+    }
+  }
+
+  uint64_t expected = undecided;
+  cas_word(&d.status, expected, make_status(seq, state));
+
+  // phase 2: release every word with its new or old value
+  uint64_t status = load(&d.status);
+  if (status_seq(status) != seq) return false;
+  bool succeeded = status_state(status) == SUCCEEDED;
+  for (uint64_t i = 0; i < s.n; i++) {
+    uint64_t found = ptr;
+    cas_word(s.entries[i].addr, found,
+             succeeded ? s.entries[i].new_val : s.entries[i].old_val);
+  }
+  return succeeded;
+}
+
+// Words must be sorted by address and free of duplicates.
+inline bool kcas(const Word* entries, int n) {
+  int tid = thread_id();
+  KcasDescriptor& d = kcas_descriptor(tid);
+  uint64_t seq =
+      (status_seq(__atomic_load_n(&d.status, __ATOMIC_RELAXED)) + 1) & SEQ_MASK;
+  __atomic_store_n(&d.status, make_status(seq, UNDECIDED), __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  KcasSnapshot s;
+  s.n = n;
+  __atomic_store_n(&d.n, s.n, __ATOMIC_RELAXED);
+  for (int i = 0; i < n; i++) {
+    s.entries[i] = entries[i];
+    __atomic_store_n(&d.entries[i].addr, entries[i].addr, __ATOMIC_RELAXED);
+    __atomic_store_n(&d.entries[i].old_val, entries[i].old_val,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&d.entries[i].new_val, entries[i].new_val,
+                     __ATOMIC_RELAXED);
+  }
+  return kcas_help(tid, make_ptr(KCAS_TAG, tid, seq), s);
+}
+
+inline uint64_t read(uint64_t* addr) {
+  while (true) {
+    uint64_t val = load(addr);
+    if (is_rdcss(val)) {
+      rdcss_help(val);
+    } else if (is_kcas(val)) {
+      // the logical value follows from the descriptor, no need to help
+      KcasDescriptor& d = kcas_descriptor(ptr_tid(val));
+      uint64_t n = __atomic_load_n(&d.n, __ATOMIC_RELAXED);
+      uint64_t old_val = 0, new_val = 0;
+      bool found = false;
+      for (uint64_t i = 0; i < n && i < MAX_WORDS; i++) {
+        if (__atomic_load_n(&d.entries[i].addr, __ATOMIC_RELAXED) == addr) {
+          old_val = __atomic_load_n(&d.entries[i].old_val, __ATOMIC_RELAXED);
+          new_val = __atomic_load_n(&d.entries[i].new_val, __ATOMIC_RELAXED);
+          found = true;
+          break;
+        }
+      }
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      uint64_t status = __atomic_load_n(&d.status, __ATOMIC_RELAXED);
+      if (found && status_seq(status) == ptr_seq(val))
+        return status_state(status) == SUCCEEDED ? new_val : old_val;
+    } else {
+      return val;
+    }
+  }
+}
+
+inline bool cas(uint64_t* addr, uint64_t old_val, uint64_t new_val) {
+  while (true) {
+    uint64_t found = old_val;
+    if (cas_word(addr, found, new_val)) return true;
+    if (is_rdcss(found)) {
+      rdcss_help(found);
+    } else if (is_kcas(found)) {
+      kcas_help(thread_id(), found);
+    } else {
+      return false;
+    }
+  }
+}
+
+}  // namespace descriptor
+}  // namespace mcas
@@ -0,0 +1,77 @@
+// Address-striped lock table for the lock-based MCAS emulation. Every word
+// hashes to one of NUM_STRIPES cache-line-padded locks; an operation takes
+// the locks of its words in stripe order, so operations on disjoint words
+// rarely contend and overlapping ones cannot deadlock.
+
+#pragma once
+
+#include <stdint.h>
+#include <initializer_list>
+#include <mutex>
+
+#include "word.h"
+
+namespace mcas {
+namespace lock_table {
+
+const int STRIPE_BITS = 12;
+const int NUM_STRIPES = 1 << STRIPE_BITS;
+
+struct alignas(64) Stripe {
+  std::mutex lock;
+};
+
+inline Stripe* stripes() {
+  static Stripe table[NUM_STRIPES];
+  return table;
+}
+
+inline unsigned int stripe_of(uint64_t* addr) {
+  // Fibonacci hashing of the word index
+  uint64_t word = reinterpret_cast<uint64_t>(addr) >> 3;
+  return static_cast<unsigned int>((word * 0x9E3779B97F4A7C15ull) >>
+                                   (64 - STRIPE_BITS));
+}
+
+// Holds the stripes of up to N words for the lifetime of the guard.
+template <int N>
+class StripeGuard {
+ public:
+  explicit StripeGuard(std::initializer_list<uint64_t*> addrs) : n_(0) {
+    for (uint64_t* addr : addrs) insert(stripe_of(addr));
+    lock_all();
+  }
+
+  StripeGuard(const Word* words, int n) : n_(0) {
+    for (int i = 0; i < n; i++) insert(stripe_of(words[i].addr));
+    lock_all();
+  }
+
+  ~StripeGuard() {
+    for (int i = n_ - 1; i >= 0; i--) stripes()[stripe_[i]].lock.unlock();
+  }
+
+  StripeGuard(const StripeGuard&) = delete;
+  StripeGuard& operator=(const StripeGuard&) = delete;
+
+ private:
+  void lock_all() {
+    for (int i = 0; i < n_; i++) stripes()[stripe_[i]].lock.lock();
+  }
+
+  // sorted insert that drops words sharing a stripe
+  void insert(unsigned int stripe) {
+    int i = n_;
+    while (i > 0 && stripe_[i - 1] > stripe) i--;
+    if (i > 0 && stripe_[i - 1] == stripe) return;
+    for (int j = n_; j > i; j--) stripe_[j] = stripe_[j - 1];
+    stripe_[i] = stripe;
+    n_++;
+  }
+
+  int n_;
+  unsigned int stripe_[N];
+};
+
+}  // namespace lock_table
+}  // namespace mcas
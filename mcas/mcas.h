@@ -1,7 +1,21 @@
+// Multi-word compare-and-swap entry points used by the lockfree-mcas
+// structures. The backend is picked at build time:
+//  - MCAS_GEM5: the MCAS instruction of the simulated hardware,
+//  - MCAS_LOCK: lock-based emulation on striped locks (lock_table.h),
+//  - default:   lock-free software MCAS on descriptors (descriptor.h).
+// kcas<N>() is the generic entry point; cas/dcas/tcas/qcas are kept for the
+// fixed arities. Words targeted by these functions are read back with
+// mcas_read(). Calls through kcas<N>() are counted by stats.h when built
+// with MCAS_STATS, and a failed one waits as backoff.h says before its
+// caller retries.
+
 #pragma once
 
 #include <stdint.h>
 
+#include "backoff.h"
+#include "stats.h"
+#include "word.h"
 
 #ifdef MCAS_GEM5
 
@@ -78,17 +92,45 @@ inline __attribute__ ((always_inline)) uint64_t qcas(uint64_t* addr0, uint64_t o
   return rax;
 }
 
-#else
+inline __attribute__ ((always_inline)) uint64_t mcas_read(uint64_t* addr) {
+  return __atomic_load_n(addr, __ATOMIC_ACQUIRE);
+}
+
+namespace mcas {
+
+const char* const BACKEND_NAME = "gem5";
+// the MCAS instruction encodes up to four words
+const int BACKEND_MAX_WORDS = 4;
+
+inline __attribute__ ((always_inline)) bool kcas_words(const Word* w, int n) {
+  switch (n) {
+    case 1:
+      return cas(w[0].addr, w[0].old_val, w[0].new_val);
+    case 2:
+      return dcas(w[0].addr, w[0].old_val, w[0].new_val,
+                  w[1].addr, w[1].old_val, w[1].new_val);
+    case 3:
+      return tcas(w[0].addr, w[0].old_val, w[0].new_val,
+                  w[1].addr, w[1].old_val, w[1].new_val,
+                  w[2].addr, w[2].old_val, w[2].new_val);
+    default:
+      return qcas(w[0].addr, w[0].old_val, w[0].new_val,
+                  w[1].addr, w[1].old_val, w[1].new_val,
+                  w[2].addr, w[2].old_val, w[2].new_val,
+                  w[3].addr, w[3].old_val, w[3].new_val);
+  }
+}
 
-#include <mutex>
+}  // namespace mcas
 
+#elif defined(MCAS_LOCK)
 
-static std::mutex global_cas_lock;
+#include "lock_table.h"
 
 inline __attribute__ ((always_inline))
 uint64_t cas(uint64_t* addr0, uint64_t old0, uint64_t new0) {
   // atomically
-  std::lock_guard<std::mutex> lock(global_cas_lock);
+  mcas::lock_table::StripeGuard<1> lock({addr0});
   {
     if (*addr0 == old0) {
       *addr0 = new0;
@@ -102,7 +144,7 @@ inline __attribute__ ((always_inline))
 uint64_t dcas(uint64_t* addr0, uint64_t old0, uint64_t new0,
               uint64_t* addr1, uint64_t old1, uint64_t new1) {
   // atomically
-  std::lock_guard<std::mutex> lock(global_cas_lock);
+  mcas::lock_table::StripeGuard<2> lock({addr0, addr1});
   {
     if ((*addr0 == old0) && (*addr1 == old1)) {
       *addr0 = new0;
@@ -118,7 +160,7 @@ uint64_t tcas(uint64_t* addr0, uint64_t old0, uint64_t new0,
               uint64_t* addr1, uint64_t old1, uint64_t new1,
               uint64_t* addr2, uint64_t old2, uint64_t new2) {
   // atomically
-  std::lock_guard<std::mutex> lock(global_cas_lock);
+  mcas::lock_table::StripeGuard<3> lock({addr0, addr1, addr2});
   {
     if ((*addr0 == old0) && (*addr1 == old1) &&
         (*addr2 == old2)) {
@@ -137,7 +179,7 @@ uint64_t qcas(uint64_t* addr0, uint64_t old0, uint64_t new0,
               uint64_t* addr2, uint64_t old2, uint64_t new2,
               uint64_t* addr3, uint64_t old3, uint64_t new3) {
   // atomically
-  std::lock_guard<std::mutex> lock(global_cas_lock);
+  mcas::lock_table::StripeGuard<4> lock({addr0, addr1, addr2, addr3});
   {
     if ((*addr0 == old0) && (*addr1 == old1) &&
         (*addr2 == old2) && (*addr3 == old3)) {
@@ -151,4 +193,127 @@ uint64_t qcas(uint64_t* addr0, uint64_t old0, uint64_t new0,
   }
 }
 
+inline __attribute__ ((always_inline))
+uint64_t mcas_read(uint64_t* addr) {
+  return __atomic_load_n(addr, __ATOMIC_ACQUIRE);
+}
+
+namespace mcas {
+
+const char* const BACKEND_NAME = "lock";
+const int BACKEND_MAX_WORDS = MAX_WORDS;
+
+inline bool kcas_words(const Word* w, int n) {
+  // atomically
+  lock_table::StripeGuard<MAX_WORDS> lock(w, n);
+  {
+    for (int i = 0; i < n; i++) {
+      if (*w[i].addr != w[i].old_val) return false;
+    }
+    for (int i = 0; i < n; i++) {
+      *w[i].addr = w[i].new_val;
+    }
+    return true;
+  }
+}
+
+}  // namespace mcas
+
+#else
+
+#include "descriptor.h"
+
+inline __attribute__ ((always_inline))
+uint64_t cas(uint64_t* addr0, uint64_t old0, uint64_t new0) {
+  return mcas::descriptor::cas(addr0, old0, new0);
+}
+
+inline __attribute__ ((always_inline))
+uint64_t dcas(uint64_t* addr0, uint64_t old0, uint64_t new0,
+              uint64_t* addr1, uint64_t old1, uint64_t new1) {
+  mcas::Word entries[] = {{addr0, old0, new0},
+                           {addr1, old1, new1}};
+  mcas::sort_words(entries, 2);
+  return mcas::descriptor::kcas(entries, 2);
+}
+
+inline __attribute__ ((always_inline))
+uint64_t tcas(uint64_t* addr0, uint64_t old0, uint64_t new0,
+              uint64_t* addr1, uint64_t old1, uint64_t new1,
+              uint64_t* addr2, uint64_t old2, uint64_t new2) {
+  mcas::Word entries[] = {{addr0, old0, new0},
+                           {addr1, old1, new1},
+                           {addr2, old2, new2}};
+  mcas::sort_words(entries, 3);
+  return mcas::descriptor::kcas(entries, 3);
+}
+
+inline __attribute__ ((always_inline))
+uint64_t qcas(uint64_t* addr0, uint64_t old0, uint64_t new0,
+              uint64_t* addr1, uint64_t old1, uint64_t new1,
+              uint64_t* addr2, uint64_t old2, uint64_t new2,
+              uint64_t* addr3, uint64_t old3, uint64_t new3) {
+  mcas::Word entries[] = {{addr0, old0, new0},
+                           {addr1, old1, new1},
+                           {addr2, old2, new2},
+                           {addr3, old3, new3}};
+  mcas::sort_words(entries, 4);
+  return mcas::descriptor::kcas(entries, 4);
+}
+
+inline __attribute__ ((always_inline))
+uint64_t mcas_read(uint64_t* addr) {
+  return mcas::descriptor::read(addr);
+}
+
+namespace mcas {
+
+const char* const BACKEND_NAME = "descriptor";
+const int BACKEND_MAX_WORDS = MAX_WORDS;
+
+inline __attribute__ ((always_inline)) bool kcas_words(const Word* w, int n) {
+  if (n == 1) return descriptor::cas(w[0].addr, w[0].old_val, w[0].new_val);
+  return descriptor::kcas(w, n);
+}
+
+}  // namespace mcas
+
 #endif
+
+// Atomically replaces every words[i].old_val with words[i].new_val, or
+// changes nothing if any word differs. The words may be given in any order
+// and may repeat an address; the operation fails if repeats disagree.
+//
+//   kcas<2>({{&node->next, next, new_node}, {&tail, last, new_node}});
+template <int N>
+inline bool kcas(const mcas::Word (&words)[N]) {
+  static_assert(N >= 1 && N <= mcas::BACKEND_MAX_WORDS,
+                "arity not supported by the selected MCAS backend");
+  mcas::Word sorted[N];
+  for (int i = 0; i < N; i++) sorted[i] = words[i];
+  mcas::sort_words(sorted, N);
+  int n = N > 1 ? mcas::dedupe_words(sorted, N) : 1;
+  bool success = n > 0 && mcas::kcas_words(sorted, n);
+  mcas::stats::record(N, success);
+  if (!success && mcas::stats::sample_conflict()) {
+    // blame the words that changed under us, or all of them if the
+    // conflict is gone by now
+    bool changed = false;
+    for (int i = 0; i < N; i++) {
+      if (mcas_read(words[i].addr) == words[i].old_val) continue;
+      mcas::stats::record_conflict(words[i].addr);
+      changed = true;
+    }
+    if (!changed)
+      for (int i = 0; i < N; i++) mcas::stats::record_conflict(words[i].addr);
+  }
+  if (success) mcas::backoff::success();
+  else mcas::backoff::failure();
+  return success;
+}
+
+// Typed read of a field that is updated through the MCAS entry points.
+template <typename T>
+inline T mcas_read(T* addr) {
+  return mcas::from_word<T>(mcas_read(reinterpret_cast<uint64_t*>(addr)));
+}
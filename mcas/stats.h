@@ -0,0 +1,281 @@
+// Per-thread statistics of the MCAS entry points: calls and failures per
+// arity and a histogram of failed MCAS calls per operation, i.e. how many
+// times a retry loop went round before its MCAS went through. Counting is
+// compiled in with -DMCAS_STATS (cmake -DMCAS_STATS=ON); without it every
+// hook is empty and the snapshot stays zero.
+//
+// The same build can sample where failures happen: every heatmap_sample()-th
+// failed call records the words that no longer held their expected value.
+// Structures label the words worth naming (a deque's hats, the bucket
+// sentinels of a hash map, a tree root) so the hot addresses can be printed
+// as fields instead of raw pointers.
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "word.h"
+
+namespace mcas {
+namespace stats {
+
+#ifdef MCAS_STATS
+const bool ENABLED = true;
+#else
+const bool ENABLED = false;
+#endif
+
+// operations with RETRY_BUCKETS - 1 or more failed calls share the last bucket
+const int RETRY_BUCKETS = 33;
+
+struct counters {
+  uint64_t calls[MAX_WORDS + 1];     // indexed by arity
+  uint64_t failures[MAX_WORDS + 1];
+  uint64_t retries[RETRY_BUCKETS];   // operations by failed calls
+  uint64_t op_calls;                 // calls of the operation in progress
+  uint64_t op_failures;
+
+  counters() { reset(); }
+
+  void reset() { std::memset(this, 0, sizeof(*this)); }
+
+  void merge(const counters& other) {
+    for (int k = 0; k <= MAX_WORDS; k++) {
+      calls[k] += other.calls[k];
+      failures[k] += other.failures[k];
+    }
+    for (int r = 0; r < RETRY_BUCKETS; r++) retries[r] += other.retries[r];
+  }
+
+  uint64_t total_calls() const {
+    uint64_t n = 0;
+    for (int k = 0; k <= MAX_WORDS; k++) n += calls[k];
+    return n;
+  }
+
+  uint64_t total_failures() const {
+    uint64_t n = 0;
+    for (int k = 0; k <= MAX_WORDS; k++) n += failures[k];
+    return n;
+  }
+
+  uint64_t operations() const {
+    uint64_t n = 0;
+    for (int r = 0; r < RETRY_BUCKETS; r++) n += retries[r];
+    return n;
+  }
+
+  // smallest retry count r such that a fraction q of the operations
+  // retried at most r times
+  int retries_percentile(double q) const {
+    uint64_t total = operations();
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * total + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int r = 0; r < RETRY_BUCKETS; r++) {
+      seen += retries[r];
+      if (seen >= rank) return r;
+    }
+    return RETRY_BUCKETS - 1;
+  }
+};
+
+inline counters& local() {
+  thread_local counters c;
+  return c;
+}
+
+// called by kcas<N>() with the arity the caller asked for
+inline __attribute__ ((always_inline)) void record(int arity, bool success) {
+#ifdef MCAS_STATS
+  counters& c = local();
+  c.calls[arity]++;
+  c.op_calls++;
+  if (!success) {
+    c.failures[arity]++;
+    c.op_failures++;
+  }
+#else
+  (void)arity;
+  (void)success;
+#endif
+}
+
+// called by the benchmark after every operation of a structure; operations
+// that issued no MCAS at all (e.g. lookups) are not counted
+inline __attribute__ ((always_inline)) void end_operation() {
+#ifdef MCAS_STATS
+  counters& c = local();
+  if (c.op_calls == 0) return;
+  c.retries[c.op_failures < RETRY_BUCKETS ? c.op_failures : RETRY_BUCKETS - 1]++;
+  c.op_calls = 0;
+  c.op_failures = 0;
+#endif
+}
+
+// sample every nth failed call into the heatmap, 0 disables sampling
+inline unsigned int& heatmap_sample() {
+  static unsigned int sample = 0;
+  return sample;
+}
+
+// sampled conflicts of the calling thread, by target address
+inline std::unordered_map<const void*, uint64_t>& conflicts() {
+  thread_local std::unordered_map<const void*, uint64_t> c;
+  return c;
+}
+
+// true if this failure is one to sample
+inline bool sample_conflict() {
+#ifdef MCAS_STATS
+  thread_local unsigned int countdown = 0;
+  unsigned int sample = heatmap_sample();
+  if (sample == 0) return false;
+  if (countdown == 0 || countdown > sample) countdown = sample;
+  return --countdown == 0;
+#else
+  return false;
+#endif
+}
+
+inline void record_conflict(const void* addr) {
+  conflicts()[addr]++;
+}
+
+// symbolic names of labelled words: name, name[index] or name[index]field
+class labels {
+ public:
+  static labels& instance() {
+    static labels l;
+    return l;
+  }
+
+  void add(const void* owner, const void* addr, size_t size, const char* name,
+           long index, const char* field) {
+    std::lock_guard<std::mutex> guard(lock);
+    entries[reinterpret_cast<uintptr_t>(addr)] = {size, 0, name, index, field, owner};
+  }
+
+  // count elements of stride bytes, named name[i]field
+  void add_array(const void* owner, const void* first, size_t count, size_t stride,
+                 const char* name, const char* field) {
+    std::lock_guard<std::mutex> guard(lock);
+    entries[reinterpret_cast<uintptr_t>(first)] = {count * stride, stride, name, -1, field, owner};
+  }
+
+  // drops every label of a structure that is going away
+  void forget(const void* owner) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto it = entries.begin(); it != entries.end();) {
+      if (it->second.owner == owner) it = entries.erase(it);
+      else ++it;
+    }
+  }
+
+  // the label of addr, or its raw address if none covers it
+  std::string describe(const void* addr) {
+    std::lock_guard<std::mutex> guard(lock);
+    uintptr_t a = reinterpret_cast<uintptr_t>(addr);
+    auto it = entries.upper_bound(a);
+    if (it != entries.begin()) {
+      --it;
+      if (a < it->first + it->second.size) {
+        const entry& e = it->second;
+        uintptr_t offset = a - it->first;
+        long index = e.index;
+        if (e.stride) {
+          index = offset / e.stride;
+          offset %= e.stride;
+        }
+        std::string name = e.name;
+        if (index >= 0) name += "[" + std::to_string(index) + "]";
+        name += e.field;
+        if (offset) name += "+" + std::to_string(offset);
+        return name;
+      }
+    }
+    char raw[32];
+    std::snprintf(raw, sizeof(raw), "node word %p", addr);
+    return raw;
+  }
+
+ private:
+  struct entry {
+    size_t size;
+    size_t stride;  // 0 for a single word or object
+    const char* name;
+    long index;
+    const char* field;
+    const void* owner;
+  };
+
+  std::mutex lock;
+  std::map<uintptr_t, entry> entries;
+};
+
+inline void label(const void* owner, const void* addr, size_t size, const char* name,
+                  long index = -1, const char* field = "") {
+  if (ENABLED) labels::instance().add(owner, addr, size, name, index, field);
+}
+
+inline void label_array(const void* owner, const void* first, size_t count, size_t stride,
+                        const char* name, const char* field = "") {
+  if (ENABLED) labels::instance().add_array(owner, first, count, stride, name, field);
+}
+
+inline void forget(const void* owner) {
+  if (ENABLED) labels::instance().forget(owner);
+}
+
+// sampled conflicts named while the structure they hit still exists, per
+// word and per 64-byte cache line
+struct heatmap {
+  std::map<std::string, uint64_t> words;
+  std::map<std::string, uint64_t> lines;
+
+  void add(const std::unordered_map<const void*, uint64_t>& samples) {
+    std::map<uintptr_t, std::pair<uint64_t, std::vector<std::string>>> by_line;
+    for (auto& sample : samples) {
+      std::string name = labels::instance().describe(sample.first);
+      words[name] += sample.second;
+      auto& line = by_line[reinterpret_cast<uintptr_t>(sample.first) & ~uintptr_t(63)];
+      line.first += sample.second;
+      line.second.push_back(name);
+    }
+    for (auto& line : by_line) {
+      std::sort(line.second.second.begin(), line.second.second.end());
+      std::string name;
+      for (auto& word : line.second.second) name += (name.empty() ? "" : ", ") + word;
+      lines["{" + name + "}"] += line.second.first;
+    }
+  }
+
+  void merge(const heatmap& other) {
+    for (auto& w : other.words) words[w.first] += w.second;
+    for (auto& l : other.lines) lines[l.first] += l.second;
+  }
+
+  // the n most frequent entries, most frequent first
+  static std::vector<std::pair<std::string, uint64_t>> top(const std::map<std::string, uint64_t>& counts,
+                                                           size_t n) {
+    std::vector<std::pair<std::string, uint64_t>> sorted(counts.begin(), counts.end());
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const std::pair<std::string, uint64_t>& a,
+                        const std::pair<std::string, uint64_t>& b) { return a.second > b.second; });
+    if (sorted.size() > n) sorted.resize(n);
+    return sorted;
+  }
+};
+
+}  // namespace stats
+}  // namespace mcas
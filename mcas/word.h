@@ -0,0 +1,82 @@
+// A single {address, expected, desired} triple of a k-word compare-and-swap
+// and the helpers every MCAS backend uses to normalize a set of them.
+
+#pragma once
+
+#include <stdint.h>
+#include <cassert>
+#include <cstring>
+
+namespace mcas {
+
+const int MAX_WORDS = 16;
+
+template <typename T>
+struct identity {
+  typedef T type;
+};
+
+template <typename T>
+inline uint64_t to_word(T val) {
+  static_assert(sizeof(T) == sizeof(uint64_t), "MCAS words are 64 bits wide");
+  uint64_t word;
+  std::memcpy(&word, &val, sizeof(word));
+  return word;
+}
+
+template <typename T>
+inline T from_word(uint64_t word) {
+  static_assert(sizeof(T) == sizeof(uint64_t), "MCAS words are 64 bits wide");
+  T val;
+  std::memcpy(&val, &word, sizeof(val));
+  return val;
+}
+
+struct Word {
+  uint64_t* addr;
+  uint64_t old_val;
+  uint64_t new_val;
+
+  Word() = default;
+
+  // The field type is deduced from the address alone, so nullptr and
+  // derived pointers convert without casts at the call site.
+  template <typename T>
+  Word(T* addr, typename identity<T>::type old_val,
+       typename identity<T>::type new_val)
+      : addr(reinterpret_cast<uint64_t*>(addr)),
+        old_val(to_word(old_val)),
+        new_val(to_word(new_val)) {}
+};
+
+// Sorts the words by address, an insertion sort is the right tool for
+// the handful of words an MCAS targets.
+inline void sort_words(Word* words, int n) {
+  for (int i = 1; i < n; i++) {
+    Word w = words[i];
+    int j = i - 1;
+    while (j >= 0 && words[j].addr > w.addr) {
+      words[j + 1] = words[j];
+      j--;
+    }
+    words[j + 1] = w;
+  }
+}
+
+// Merges sorted words that target the same address. Returns the number of
+// distinct words, or -1 if two of them expect different values and the
+// operation therefore can never succeed.
+inline int dedupe_words(Word* words, int n) {
+  int m = 0;
+  for (int i = 0; i < n; i++) {
+    if (m > 0 && words[m - 1].addr == words[i].addr) {
+      if (words[m - 1].old_val != words[i].old_val) return -1;
+      assert(words[m - 1].new_val == words[i].new_val);
+      continue;
+    }
+    words[m++] = words[i];
+  }
+  return m;
+}
+
+}  // namespace mcas
@@ -0,0 +1,14 @@
+#pragma once
+
+/* layout of the fields that different threads write. Built with
+ * -DPAD_HOT_FIELDS (cmake -DPAD_HOT_FIELDS=ON) every field marked
+ * CACHE_ALIGNED starts its own cache line, so the cross-thread slowdown of
+ * a run with padding is true contention only; the default keeps the
+ * packed layout the structures were written with */
+#ifdef PAD_HOT_FIELDS
+#define CACHE_ALIGNED alignas(64)
+const bool PADDED_LAYOUT = true;
+#else
+#define CACHE_ALIGNED
+const bool PADDED_LAYOUT = false;
+#endif
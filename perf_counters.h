@@ -0,0 +1,106 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "configuration.h"
+
+struct perf_event_spec {
+  std::string name;
+  uint32_t type;
+  uint64_t config;
+};
+
+inline uint64_t perf_cache_miss(uint64_t cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+/* the generic events every PMU should offer, followed by the raw,
+ * model-specific ones given with --perf-raw (offcore responses, HITM) */
+inline std::vector<perf_event_spec> perf_event_specs(const Configuration& config) {
+  std::vector<perf_event_spec> specs;
+  if (!config.perf_counters) return specs;
+  specs.push_back({"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES});
+  specs.push_back({"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS});
+  specs.push_back({"llc-misses", PERF_TYPE_HW_CACHE, perf_cache_miss(PERF_COUNT_HW_CACHE_LL)});
+  specs.push_back({"l1d-misses", PERF_TYPE_HW_CACHE, perf_cache_miss(PERF_COUNT_HW_CACHE_L1D)});
+  specs.push_back({"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES});
+  for (auto& raw : config.perf_raw_events)
+    specs.push_back({raw.first, PERF_TYPE_RAW, raw.second});
+  return specs;
+}
+
+/* counters of the calling thread, user space only. Every event is opened
+ * on its own so one the PMU lacks does not take the others down; events
+ * that cannot be opened read as unavailable (negative) */
+class perf_counters {
+ public:
+  explicit perf_counters(const std::vector<perf_event_spec>& specs) : fds(specs.size(), -1) {
+    for (size_t i = 0; i < specs.size(); i++) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = specs[i].type;
+      attr.config = specs[i].config;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+      if (fds[i] < 0) last_error().store(errno, std::memory_order_relaxed);
+    }
+  }
+
+  ~perf_counters() {
+    for (int fd : fds)
+      if (fd >= 0) close(fd);
+  }
+
+  perf_counters(const perf_counters&) = delete;
+  perf_counters& operator=(const perf_counters&) = delete;
+
+  void start() {
+    for (int fd : fds) {
+      if (fd < 0) continue;
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  void stop() {
+    for (int fd : fds)
+      if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+
+  /* counts scaled up for the time an event was multiplexed out */
+  std::vector<double> read() const {
+    std::vector<double> counts(fds.size(), -1);
+    for (size_t i = 0; i < fds.size(); i++) {
+      uint64_t value[3];
+      if (fds[i] < 0 || ::read(fds[i], value, sizeof(value)) != sizeof(value)) continue;
+      if (value[2] == 0) continue;
+      counts[i] = static_cast<double>(value[0]) * value[1] / value[2];
+    }
+    return counts;
+  }
+
+  /* errno of the last event that failed to open, 0 if none did; every
+   * worker thread opens its own counters, so it is set concurrently */
+  static std::atomic<int>& last_error() {
+    static std::atomic<int> error(0);
+    return error;
+  }
+
+ private:
+  std::vector<int> fds;
+};
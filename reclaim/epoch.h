@@ -0,0 +1,213 @@
+// Epoch-based reclamation (Fraser 2004, "Practical lock-freedom") for nodes
+// unlinked from the lock-free structures. Every operation runs inside a
+// guard that announces the global epoch it observed; a node retired while
+// the global epoch is e is freed once the epoch has reached e + 2, when no
+// thread that could still hold a reference to it is left in its critical
+// section.
+//
+// Retired nodes wait in per-thread limbo lists, one per epoch modulo three,
+// so retiring never synchronizes with other threads. A thread tries to
+// advance the global epoch every RETIRE_SCAN retirements. The lists of a
+// thread that exits are handed to the domain and freed by whichever thread
+// advances the epoch far enough, or by drain() at a quiescent point.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "retired.h"
+
+namespace reclaim {
+namespace epoch {
+
+const int MAX_THREADS = 1024;
+const unsigned int RETIRE_SCAN = 64;
+const uint64_t QUIESCENT = ~0ull;
+
+struct limbo {
+  uint64_t epoch;
+  std::vector<retired> nodes;
+
+  void free_all() {
+    for (auto& r : nodes) r.deleter(r.ptr);
+    nodes.clear();
+  }
+};
+
+class domain {
+ public:
+  static domain& instance() {
+    static domain d;
+    return d;
+  }
+
+  uint64_t current() const { return global.load(std::memory_order_seq_cst); }
+
+  // leases an announcement slot to a new thread
+  int acquire() {
+    while (true) {
+      for (int i = 0; i < MAX_THREADS; i++) {
+        bool expected = false;
+        if (!slots[i].leased.load(std::memory_order_relaxed) &&
+            slots[i].leased.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+          int used = in_use.load(std::memory_order_relaxed);
+          while (used < i + 1 && !in_use.compare_exchange_weak(used, i + 1)) {}
+          return i;
+        }
+      }
+    }
+  }
+
+  void release(int slot, limbo* bags, int n) {
+    {
+      std::lock_guard<std::mutex> guard(orphans_lock);
+      for (int i = 0; i < n; i++)
+        if (!bags[i].nodes.empty()) orphans.push_back(std::move(bags[i]));
+    }
+    slots[slot].announced.store(QUIESCENT, std::memory_order_release);
+    slots[slot].leased.store(false, std::memory_order_release);
+  }
+
+  std::atomic<uint64_t>& announcement(int slot) { return slots[slot].announced; }
+
+  // moves the global epoch on if every thread in a critical section has
+  // seen the current one
+  bool try_advance() {
+    uint64_t e = current();
+    int used = in_use.load(std::memory_order_acquire);
+    for (int i = 0; i < used; i++) {
+      uint64_t a = slots[i].announced.load(std::memory_order_seq_cst);
+      if (a != QUIESCENT && a != e) return false;
+    }
+    if (!global.compare_exchange_strong(e, e + 1)) return false;
+    free_orphans(e + 1);
+    return true;
+  }
+
+  // frees everything left by exited threads; only call while no thread is
+  // inside a critical section
+  void drain() {
+    std::lock_guard<std::mutex> guard(orphans_lock);
+    for (auto& bag : orphans) bag.free_all();
+    orphans.clear();
+  }
+
+ private:
+  struct alignas(64) slot {
+    std::atomic<uint64_t> announced;
+    std::atomic<bool> leased;
+    slot() : announced(QUIESCENT), leased(false) {}
+  };
+
+  domain() : global(0), in_use(0) {}
+
+  void free_orphans(uint64_t e) {
+    std::unique_lock<std::mutex> guard(orphans_lock, std::try_to_lock);
+    if (!guard.owns_lock()) return;
+    size_t kept = 0;
+    for (size_t i = 0; i < orphans.size(); i++) {
+      if (orphans[i].epoch + 2 <= e) orphans[i].free_all();
+      else if (kept++ != i) orphans[kept - 1] = std::move(orphans[i]);
+    }
+    orphans.resize(kept);
+  }
+
+  alignas(64) std::atomic<uint64_t> global;
+  alignas(64) std::atomic<int> in_use;  // slots below this may be leased
+  slot slots[MAX_THREADS];
+  std::mutex orphans_lock;
+  std::vector<limbo> orphans;
+};
+
+class thread_context {
+ public:
+  thread_context() : slot(domain::instance().acquire()), depth(0), retirements(0) {
+    for (auto& bag : bags) bag.epoch = 0;
+  }
+
+  ~thread_context() { domain::instance().release(slot, bags, 3); }
+
+  void enter() {
+    if (depth++ > 0) return;
+    domain& d = domain::instance();
+    auto& announced = d.announcement(slot);
+    /* re-announce until the epoch did not move in between, so an
+     * announcement is never older than the epoch it was made in */
+    uint64_t e = d.current();
+    while (true) {
+      announced.store(e, std::memory_order_seq_cst);
+      uint64_t now = d.current();
+      if (now == e) break;
+      e = now;
+    }
+  }
+
+  void exit() {
+    if (--depth > 0) return;
+    domain::instance().announcement(slot).store(QUIESCENT, std::memory_order_release);
+  }
+
+  void retire(void* ptr, void (*deleter)(void*)) {
+    domain& d = domain::instance();
+    uint64_t e = d.current();
+    limbo& bag = bags[e % 3];
+    /* the bag last filled three or more epochs ago: safe to free */
+    if (bag.epoch != e) {
+      bag.free_all();
+      bag.epoch = e;
+    }
+    bag.nodes.push_back({ptr, deleter});
+    if (++retirements % RETIRE_SCAN == 0) d.try_advance();
+  }
+
+  // frees this thread's limbo lists; only call at a quiescent point
+  void drain() {
+    for (auto& bag : bags) bag.free_all();
+  }
+
+ private:
+  int slot;
+  unsigned int depth;
+  unsigned int retirements;
+  limbo bags[3];
+};
+
+inline thread_context& local() {
+  thread_local thread_context context;
+  return context;
+}
+
+// scope of one operation on a structure; guards nest
+class guard {
+ public:
+  guard() { local().enter(); }
+  ~guard() { local().exit(); }
+
+  guard(const guard&) = delete;
+  guard& operator=(const guard&) = delete;
+};
+
+// hands an unlinked node over for deletion once no guard can reach it
+template <typename T>
+inline void retire(T* node) {
+  local().retire(node, [](void* p) { delete static_cast<T*>(p); });
+}
+
+// the same for nodes that did not come from new
+inline void retire(void* node, void (*deleter)(void*)) {
+  local().retire(node, deleter);
+}
+
+// frees every retired node, assuming no thread is inside a guard, e.g.
+// after the workers of a run have been joined
+inline void drain() {
+  local().drain();
+  domain::instance().drain();
+}
+
+}  // namespace epoch
+}  // namespace reclaim
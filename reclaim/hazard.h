@@ -0,0 +1,190 @@
+// Hazard pointers (Michael 2004, "Hazard pointers: safe memory reclamation
+// for lock-free objects"). Before it dereferences a shared node a thread
+// publishes the node's address in one of its SLOTS hazard pointers and
+// re-reads the link it came from; a retired node is freed only once no
+// published hazard pointer holds it.
+//
+// Garbage is bounded: a thread scans the hazard pointers whenever its retire
+// list reaches twice the number of hazard pointers in use, and a scan keeps
+// only the nodes that are still published. Unlike epochs, a stalled thread
+// pins at most SLOTS nodes instead of everything retired after it stalled.
+// The list of a thread that exits is handed to the domain and rescanned by
+// the next thread that scans, or freed by drain() at a quiescent point.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "retired.h"
+
+namespace reclaim {
+namespace hazard {
+
+const int MAX_THREADS = 1024;
+const int SLOTS = 3;
+const size_t MIN_SCAN = 64;
+
+class domain {
+ public:
+  static domain& instance() {
+    static domain d;
+    return d;
+  }
+
+  // leases a record of hazard pointers to a new thread
+  int acquire() {
+    while (true) {
+      for (int i = 0; i < MAX_THREADS; i++) {
+        bool expected = false;
+        if (!records[i].leased.load(std::memory_order_relaxed) &&
+            records[i].leased.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+          int used = in_use.load(std::memory_order_relaxed);
+          while (used < i + 1 && !in_use.compare_exchange_weak(used, i + 1)) {}
+          return i;
+        }
+      }
+    }
+  }
+
+  void release(int slot, std::vector<retired>& nodes) {
+    {
+      std::lock_guard<std::mutex> guard(orphans_lock);
+      orphans.insert(orphans.end(), nodes.begin(), nodes.end());
+    }
+    nodes.clear();
+    for (auto& p : records[slot].pointers) p.store(nullptr, std::memory_order_release);
+    records[slot].leased.store(false, std::memory_order_release);
+  }
+
+  std::atomic<void*>& pointer(int slot, int i) { return records[slot].pointers[i]; }
+
+  // retire list length that triggers a scan
+  size_t threshold() const {
+    size_t published = 2 * SLOTS * static_cast<size_t>(in_use.load(std::memory_order_relaxed));
+    return std::max(MIN_SCAN, published);
+  }
+
+  // frees the nodes of list that no hazard pointer holds, together with
+  // those of exited threads if nobody else is scanning them
+  void scan(std::vector<retired>& list, std::vector<void*>& hazards) {
+    hazards.clear();
+    int used = in_use.load(std::memory_order_acquire);
+    for (int i = 0; i < used; i++)
+      for (auto& p : records[i].pointers) {
+        void* node = p.load(std::memory_order_seq_cst);
+        if (node) hazards.push_back(node);
+      }
+    std::sort(hazards.begin(), hazards.end());
+    free_unprotected(list, hazards);
+    std::unique_lock<std::mutex> guard(orphans_lock, std::try_to_lock);
+    if (guard.owns_lock()) free_unprotected(orphans, hazards);
+  }
+
+  // frees everything left by exited threads; only call while no thread
+  // holds a hazard pointer
+  void drain() {
+    std::lock_guard<std::mutex> guard(orphans_lock);
+    for (auto& r : orphans) r.deleter(r.ptr);
+    orphans.clear();
+  }
+
+ private:
+  struct alignas(64) record {
+    std::atomic<void*> pointers[SLOTS];
+    std::atomic<bool> leased;
+    record() : leased(false) {
+      for (auto& p : pointers) p.store(nullptr, std::memory_order_relaxed);
+    }
+  };
+
+  domain() : in_use(0) {}
+
+  static void free_unprotected(std::vector<retired>& list, const std::vector<void*>& hazards) {
+    size_t kept = 0;
+    for (size_t i = 0; i < list.size(); i++) {
+      if (!std::binary_search(hazards.begin(), hazards.end(), list[i].ptr)) list[i].deleter(list[i].ptr);
+      else list[kept++] = list[i];
+    }
+    list.resize(kept);
+  }
+
+  alignas(64) std::atomic<int> in_use;  // records below this may be leased
+  record records[MAX_THREADS];
+  std::mutex orphans_lock;
+  std::vector<retired> orphans;
+};
+
+class thread_context {
+ public:
+  thread_context() : slot(domain::instance().acquire()) {}
+
+  ~thread_context() {
+    clear();
+    domain::instance().scan(nodes, hazards);
+    domain::instance().release(slot, nodes);
+  }
+
+  void set(int i, void* node) {
+    domain::instance().pointer(slot, i).store(node, std::memory_order_seq_cst);
+  }
+
+  void clear() {
+    for (int i = 0; i < SLOTS; i++)
+      domain::instance().pointer(slot, i).store(nullptr, std::memory_order_release);
+  }
+
+  void retire(void* ptr, void (*deleter)(void*)) {
+    nodes.push_back({ptr, deleter});
+    domain& d = domain::instance();
+    if (nodes.size() >= d.threshold()) d.scan(nodes, hazards);
+  }
+
+  // frees this thread's retire list; only call at a quiescent point
+  void drain() {
+    for (auto& r : nodes) r.deleter(r.ptr);
+    nodes.clear();
+  }
+
+ private:
+  int slot;
+  std::vector<retired> nodes;
+  std::vector<void*> hazards;  // scratch space of scan()
+};
+
+inline thread_context& local() {
+  thread_local thread_context context;
+  return context;
+}
+
+// loads *link and publishes it in hazard pointer i, retrying until the
+// link still holds the published node; the node then stays allocated until
+// the hazard pointer is overwritten or cleared
+template <typename T>
+inline T* protect(int i, T* const* link) {
+  thread_context& context = local();
+  T* node = __atomic_load_n(link, __ATOMIC_ACQUIRE);
+  while (true) {
+    context.set(i, node);
+    T* again = __atomic_load_n(link, __ATOMIC_SEQ_CST);
+    if (again == node) return node;
+    node = again;
+  }
+}
+
+// hands an unlinked node over for deletion once no hazard pointer holds it
+template <typename T>
+inline void retire(T* node) {
+  local().retire(node, [](void* p) { delete static_cast<T*>(p); });
+}
+
+// frees every retired node, assuming no thread holds a hazard pointer
+inline void drain() {
+  local().drain();
+  domain::instance().drain();
+}
+
+}  // namespace hazard
+}  // namespace reclaim
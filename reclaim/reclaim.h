@@ -0,0 +1,85 @@
+// Reclamation scheme of the classic lock-free structures (lockfree/), chosen
+// at run time so one binary measures what each costs on the hot path:
+//  - NONE:   unlinked nodes are never freed, the structures' original
+//            behaviour,
+//  - EPOCH:  epoch-based reclamation (epoch.h), one announcement per
+//            operation,
+//  - HAZARD: hazard pointers (hazard.h), one published pointer and
+//            re-validation per node visited, but bounded garbage.
+// Structures bracket every operation with a guard, read links they are
+// about to dereference through protect() or publish(), and hand unlinked
+// nodes to retire(); whatever the scheme does not need is a no-op.
+
+#pragma once
+
+#include "epoch.h"
+#include "hazard.h"
+
+namespace reclaim {
+
+enum Scheme {
+  NONE,
+  EPOCH,
+  HAZARD
+};
+
+inline Scheme& scheme() {
+  static Scheme s = EPOCH;
+  return s;
+}
+
+// scope of one operation on a structure
+class guard {
+ public:
+  explicit guard(Scheme s = scheme()) : s(s) {
+    if (s == EPOCH) epoch::local().enter();
+  }
+  ~guard() {
+    if (s == EPOCH) epoch::local().exit();
+    else if (s == HAZARD) hazard::local().clear();
+  }
+
+  guard(const guard&) = delete;
+  guard& operator=(const guard&) = delete;
+
+ private:
+  Scheme s;
+};
+
+// reads a link whose target the caller is about to dereference, publishing
+// the target in hazard pointer i if hazard pointers are in use
+template <typename T>
+inline T* protect(int i, T* const* link) {
+  if (scheme() == HAZARD) return hazard::protect(i, link);
+  return __atomic_load_n(link, __ATOMIC_ACQUIRE);
+}
+
+// publishes a node in hazard pointer i; the caller re-validates the link it
+// read the node from before dereferencing it
+template <typename T>
+inline void publish(int i, T* node) {
+  if (scheme() == HAZARD) hazard::local().set(i, node);
+}
+
+template <typename T>
+inline void retire(T* node, Scheme s = scheme()) {
+  switch (s) {
+    case EPOCH:
+      epoch::retire(node);
+      break;
+    case HAZARD:
+      hazard::retire(node);
+      break;
+    case NONE:
+      break;
+  }
+}
+
+// frees the nodes retired under every scheme; only call at a quiescent
+// point, e.g. after the workers of a run have been joined
+inline void drain() {
+  epoch::drain();
+  hazard::drain();
+}
+
+}  // namespace reclaim
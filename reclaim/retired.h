@@ -0,0 +1,12 @@
+#pragma once
+
+namespace reclaim {
+
+// an unlinked node waiting to be freed, type-erased so one list can hold
+// the nodes of every structure
+struct retired {
+  void* ptr;
+  void (*deleter)(void*);
+};
+
+}  // namespace reclaim
@@ -0,0 +1,385 @@
+#pragma once
+
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "configuration.h"
+#include "histogram.h"
+#include "perf_counters.h"
+#include "mcas/mcas.h"
+#include "padding.h"
+
+inline const char* sync_type_name(Configuration::SyncType sync_type) {
+  switch (sync_type) {
+    case Configuration::SyncType::LOCK: return "lock";
+    case Configuration::SyncType::LOCKFREE: return "lockfree";
+    case Configuration::SyncType::LOCKFREE_MCAS: return "lockfree-mcas";
+    case Configuration::SyncType::LOCKFREE_RING: return "lockfree-ring";
+    case Configuration::SyncType::LOCKFREE_MCAS_RING: return "lockfree-mcas-ring";
+    case Configuration::SyncType::LOCKFREE_FAA: return "lockfree-faa";
+    default: return "undefined";
+  }
+}
+
+inline const char* reclaim_name(Configuration::ReclaimScheme reclaim) {
+  switch (reclaim) {
+    case Configuration::ReclaimScheme::RECLAIM_NONE: return "none";
+    case Configuration::ReclaimScheme::RECLAIM_EPOCH: return "epoch";
+    case Configuration::ReclaimScheme::RECLAIM_HAZARD: return "hazard";
+    default: return "undefined";
+  }
+}
+
+inline const char* allocator_name(Configuration::NodeAllocator allocator) {
+  switch (allocator) {
+    case Configuration::NodeAllocator::ALLOC_HEAP: return "heap";
+    case Configuration::NodeAllocator::ALLOC_POOL: return "pool";
+    default: return "undefined";
+  }
+}
+
+inline const char* algorithm_name(Configuration::BenchmarkAlgorithm algorithm) {
+  switch (algorithm) {
+    case Configuration::BenchmarkAlgorithm::MWOBJECT: return "mwobject";
+    case Configuration::BenchmarkAlgorithm::ARRAYSWAP: return "arrayswap";
+    case Configuration::BenchmarkAlgorithm::STACK: return "stack";
+    case Configuration::BenchmarkAlgorithm::QUEUE: return "queue";
+    case Configuration::BenchmarkAlgorithm::DEQUE: return "deque";
+    case Configuration::BenchmarkAlgorithm::SORTEDLIST: return "sorted-list";
+    case Configuration::BenchmarkAlgorithm::HASHMAP: return "hashmap";
+    case Configuration::BenchmarkAlgorithm::BST: return "bst";
+    case Configuration::BenchmarkAlgorithm::SPSC: return "spsc";
+    default: return "undefined";
+  }
+}
+
+/* the machine a result was measured on */
+struct host_info {
+  std::string hostname;
+  std::string cpu;
+  unsigned int cpus;
+  std::string kernel;
+  std::string compiler;
+  std::string mcas_backend;
+  bool padded_layout;
+  std::string timestamp;
+
+  static const host_info& get() {
+    static host_info host = probe();
+    return host;
+  }
+
+ private:
+  static host_info probe() {
+    host_info host;
+    char name[256] = {};
+    gethostname(name, sizeof(name) - 1);
+    host.hostname = name;
+
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+      if (line.compare(0, 10, "model name") != 0) continue;
+      auto colon = line.find(':');
+      if (colon != std::string::npos && colon + 2 <= line.size())
+        host.cpu = line.substr(colon + 2);
+      break;
+    }
+
+    host.cpus = std::thread::hardware_concurrency();
+    struct utsname uts;
+    if (uname(&uts) == 0)
+      host.kernel = std::string(uts.sysname) + " " + uts.release + " " + uts.machine;
+    host.compiler = __VERSION__;
+    host.mcas_backend = mcas::BACKEND_NAME;
+    host.padded_layout = PADDED_LAYOUT;
+
+    char stamp[32] = {};
+    std::time_t now = std::time(nullptr);
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    host.timestamp = stamp;
+    return host;
+  }
+};
+
+/* one run of one benchmark phase, as written to machine-readable output */
+struct result_record {
+  std::string phase;
+  unsigned int run;
+  unsigned int threads;
+  unsigned long ops;
+  double time;        // ms
+  double throughput;  // Mops/s
+  std::vector<double> per_thread;
+  std::vector<std::string> op_names;
+  std::vector<unsigned long> calls;  // operations per kind
+  std::vector<latency_histogram> latency;
+  std::vector<double> counters_per_op;  // per perf_event_specs, negative if unavailable
+};
+
+/* writes results as JSON or CSV to --output, or to stdout; the human
+ * readable report then moves to stderr so the two never interleave */
+class result_writer {
+ public:
+  static result_writer& instance() {
+    static result_writer writer;
+    return writer;
+  }
+
+  bool open(const Configuration& config) {
+    this->config = config;
+    if (config.output_format == Configuration::OutputFormat::TEXT) return true;
+    if (!config.output_file.empty()) {
+      file.open(config.output_file);
+      if (!file) return false;
+    }
+    if (config.output_format == Configuration::OutputFormat::JSON) out() << "[";
+    if (config.output_format == Configuration::OutputFormat::CSV) out() << csv_header();
+    return true;
+  }
+
+  void close() {
+    if (config.output_format == Configuration::OutputFormat::JSON)
+      out() << (records ? "\n]\n" : "]\n");
+    out().flush();
+    if (file.is_open()) file.close();
+  }
+
+  /* where progress and the text report go */
+  std::ostream& console() {
+    bool machine_on_stdout = config.output_format != Configuration::OutputFormat::TEXT &&
+                             config.output_file.empty();
+    return machine_on_stdout ? std::cerr : std::cout;
+  }
+
+  /* run is the configuration the record was measured with */
+  void write(const Configuration& run, const result_record& record) {
+    switch (config.output_format) {
+      case Configuration::OutputFormat::JSON: write_json(run, record); break;
+      case Configuration::OutputFormat::CSV: write_csv(run, record); break;
+      case Configuration::OutputFormat::TEXT: break;
+    }
+    records++;
+  }
+
+ private:
+  result_writer() : records(0) {}
+
+  std::ostream& out() { return file.is_open() ? static_cast<std::ostream&>(file) : std::cout; }
+
+  static std::string quote(const std::string& s) {
+    std::string quoted = "\"";
+    for (char c : s) {
+      if (c == '"' || c == '\\') quoted += '\\';
+      quoted += c;
+    }
+    return quoted + "\"";
+  }
+
+  static std::string csv_field(const std::string& s) {
+    std::string field = "\"";
+    for (char c : s) {
+      if (c == '"') field += '"';
+      field += c;
+    }
+    return field + "\"";
+  }
+
+  static const double* percentiles() {
+    static const double q[] = {0.5, 0.9, 0.99, 0.999};
+    return q;
+  }
+
+  static std::string csv_header() {
+    return "sync,algorithm,reclaim,allocator,phase,run,threads,ops,duration_ms,throughput_mops,"
+           "op,calls,samples,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,"
+           "cycles_per_op,instructions_per_op,llc_misses_per_op,l1d_misses_per_op,"
+           "branch_misses_per_op,raw_counters_per_op,"
+           "hostname,cpu,cpus,kernel,compiler,mcas_backend,padded_layout,timestamp\n";
+  }
+
+  void write_json(const Configuration& run, const result_record& r) {
+    auto& host = host_info::get();
+    std::ostream& o = out();
+    o << (records ? ",\n" : "\n") << "  {"
+      << "\"sync\": " << quote(sync_type_name(run.sync_type))
+      << ", \"algorithm\": " << quote(algorithm_name(run.benchmarking_algorithm))
+      << ", \"reclaim\": " << quote(reclaim_name(run.reclaim))
+      << ", \"allocator\": " << quote(allocator_name(run.node_allocator))
+      << ", \"phase\": " << quote(r.phase)
+      << ", \"run\": " << r.run
+      << ", \"threads\": " << r.threads
+      << ", \"ops\": " << r.ops
+      << ", \"duration_ms\": " << r.time
+      << ", \"throughput_mops\": " << r.throughput
+      << ", \"per_thread_mops\": [";
+    for (size_t i = 0; i < r.per_thread.size(); i++) o << (i ? ", " : "") << r.per_thread[i];
+    o << "], \"ops_per_kind\": {";
+    for (size_t k = 0; k < r.calls.size(); k++)
+      o << (k ? ", " : "") << quote(r.op_names[k]) << ": " << r.calls[k];
+    o << "}, \"latency_ns\": {";
+    bool first = true;
+    for (size_t k = 0; k < r.latency.size(); k++) {
+      auto& h = r.latency[k];
+      if (h.count() == 0) continue;
+      o << (first ? "" : ", ") << quote(r.op_names[k]) << ": {\"samples\": " << h.count()
+        << ", \"p50\": " << h.percentile(percentiles()[0])
+        << ", \"p90\": " << h.percentile(percentiles()[1])
+        << ", \"p99\": " << h.percentile(percentiles()[2])
+        << ", \"p999\": " << h.percentile(percentiles()[3])
+        << ", \"max\": " << h.max() << "}";
+      first = false;
+    }
+    auto events = perf_event_specs(run);
+    o << "}, \"counters_per_op\": {";
+    for (size_t e = 0; e < events.size(); e++) {
+      o << (e ? ", " : "") << quote(events[e].name) << ": ";
+      if (r.counters_per_op[e] < 0) o << "null";
+      else o << r.counters_per_op[e];
+    }
+    o << "}, \"host\": {"
+      << "\"hostname\": " << quote(host.hostname)
+      << ", \"cpu\": " << quote(host.cpu)
+      << ", \"cpus\": " << host.cpus
+      << ", \"kernel\": " << quote(host.kernel)
+      << ", \"compiler\": " << quote(host.compiler)
+      << ", \"mcas_backend\": " << quote(host.mcas_backend)
+      << ", \"padded_layout\": " << (host.padded_layout ? "true" : "false")
+      << ", \"timestamp\": " << quote(host.timestamp) << "}}";
+  }
+
+  /* one row per operation kind with its call count and, if latency was
+   * recorded, its percentiles */
+  void write_csv(const Configuration& run, const result_record& r) {
+    auto& host = host_info::get();
+    std::ostringstream common;
+    common << sync_type_name(run.sync_type) << ","
+           << algorithm_name(run.benchmarking_algorithm) << ","
+           << reclaim_name(run.reclaim) << ","
+           << allocator_name(run.node_allocator) << ","
+           << r.phase << "," << r.run << "," << r.threads << "," << r.ops << ","
+           << r.time << "," << r.throughput << ",";
+    /* the generic events get a column each, raw events share one */
+    auto events = perf_event_specs(run);
+    std::ostringstream counters;
+    const size_t GENERIC_EVENTS = 5;
+    std::string raw;
+    for (size_t e = 0; e < GENERIC_EVENTS; e++) {
+      if (e < events.size() && r.counters_per_op[e] >= 0) counters << r.counters_per_op[e];
+      counters << ",";
+    }
+    for (size_t e = GENERIC_EVENTS; e < events.size(); e++) {
+      if (r.counters_per_op[e] < 0) continue;
+      std::ostringstream value;
+      value << events[e].name << "=" << r.counters_per_op[e];
+      raw += (raw.empty() ? "" : ";") + value.str();
+    }
+    counters << raw << ",";
+    std::ostringstream machine;
+    machine << csv_field(host.hostname) << "," << csv_field(host.cpu) << "," << host.cpus << ","
+            << csv_field(host.kernel) << "," << csv_field(host.compiler) << ","
+            << host.mcas_backend << "," << host.padded_layout << "," << host.timestamp << "\n";
+
+    for (size_t k = 0; k < r.calls.size(); k++) {
+      out() << common.str() << r.op_names[k] << "," << r.calls[k] << ",";
+      if (k < r.latency.size() && r.latency[k].count()) {
+        auto& h = r.latency[k];
+        out() << h.count() << ","
+              << h.percentile(percentiles()[0]) << "," << h.percentile(percentiles()[1]) << ","
+              << h.percentile(percentiles()[2]) << "," << h.percentile(percentiles()[3]) << ","
+              << h.max() << ",";
+      } else {
+        out() << ",,,,,,";
+      }
+      out() << counters.str() << machine.str();
+    }
+  }
+
+  Configuration config;
+  std::ofstream file;
+  unsigned long records;
+};
+
+inline std::ostream& console() { return result_writer::instance().console(); }
+
+/* throughput per sync type, phase and thread count of a thread sweep,
+ * printed as speedup and parallel efficiency over the smallest thread
+ * count of the sweep (1 thread when the sweep includes it) */
+class scaling_table {
+ public:
+  static scaling_table& instance() {
+    static scaling_table table;
+    return table;
+  }
+
+  void add(const Configuration& run, const std::string& phase, unsigned int threads,
+           double throughput) {
+    if (std::find(phases.begin(), phases.end(), phase) == phases.end()) phases.push_back(phase);
+    throughputs[phase][threads][run.sync_type] = throughput;
+  }
+
+  void print(std::ostream& out, const Configuration& config) const {
+    for (auto& phase : phases) {
+      auto& rows = throughputs.at(phase);
+      /* a column per sync type that ran, in declaration order */
+      std::set<Configuration::SyncType> sync_types;
+      for (auto& row : rows)
+        for (auto& measured : row.second) sync_types.insert(measured.first);
+      out << "scaling " << algorithm_name(config.benchmarking_algorithm) << " " << phase
+          << " (Mops/s, speedup, efficiency)\n";
+      out << std::setw(8) << "threads";
+      for (auto sync : sync_types) out << std::setw(30) << sync_type_name(sync);
+      out << "\n";
+
+      for (auto& row : rows) {
+        out << std::setw(8) << row.first;
+        for (auto sync : sync_types) {
+          auto measured = row.second.find(sync);
+          double base = baseline(rows, sync);
+          if (measured == row.second.end() || base <= 0) {
+            out << std::setw(30) << "-";
+            continue;
+          }
+          unsigned int base_threads = baseline_threads(rows, sync);
+          double speedup = measured->second / base;
+          double efficiency = speedup * base_threads / row.first;
+          std::ostringstream cell;
+          cell << std::fixed << std::setprecision(2) << measured->second << " "
+               << speedup << "x " << std::setprecision(0) << efficiency * 100 << "%";
+          out << std::setw(30) << cell.str();
+        }
+        out << "\n";
+      }
+    }
+  }
+
+ private:
+  typedef std::map<unsigned int, std::map<Configuration::SyncType, double>> Rows;
+
+  static unsigned int baseline_threads(const Rows& rows, Configuration::SyncType sync) {
+    for (auto& row : rows)
+      if (row.second.count(sync)) return row.first;
+    return 0;
+  }
+
+  static double baseline(const Rows& rows, Configuration::SyncType sync) {
+    for (auto& row : rows)
+      if (row.second.count(sync)) return row.second.at(sync);
+    return 0;
+  }
+
+  std::vector<std::string> phases;
+  std::map<std::string, Rows> throughputs;
+};
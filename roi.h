@@ -0,0 +1,109 @@
+#pragma once
+
+#ifdef ENABLE_PARSEC_HOOKS
+#include <hooks.h>
+#endif
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "configuration.h"
+
+/* region of interest: the part of a run a simulator or an external
+ * profiler should look at. Every phase (prefill, read, update, mixed, ...)
+ * is its own region; by default only the measured phases are, so gem5 and
+ * native runs cover exactly the same hot code */
+namespace roi {
+
+inline bool selected(const Configuration& config, const std::string& phase) {
+  if (config.roi_backend == Configuration::RoiBackend::ROI_NONE) return false;
+  if (config.roi_phases.empty()) return phase != "prefill";
+  return std::find(config.roi_phases.begin(), config.roi_phases.end(), phase) !=
+         config.roi_phases.end();
+}
+
+/* perf stat --delay=-1 --control fd:CTL,ACK hands its control pipe to the
+ * benchmark through PERF_CTL_FD and PERF_ACK_FD */
+inline void perf_control(const char* command) {
+  static const char* ctl = std::getenv("PERF_CTL_FD");
+  static const char* ack = std::getenv("PERF_ACK_FD");
+  if (!ctl) return;
+  std::string line = std::string(command) + "\n";
+  if (write(std::atoi(ctl), line.data(), line.size()) < 0) return;
+  if (ack) {
+    char reply[16];
+    if (read(std::atoi(ack), reply, sizeof(reply)) < 0) return;
+  }
+}
+
+inline std::chrono::steady_clock::time_point& trace_start() {
+  static std::chrono::steady_clock::time_point start;
+  return start;
+}
+
+inline void begin(const Configuration& config, const std::string& phase) {
+  if (!selected(config, phase)) return;
+  switch (config.roi_backend) {
+    case Configuration::RoiBackend::ROI_PARSEC:
+#ifdef ENABLE_PARSEC_HOOKS
+      __parsec_roi_begin();
+#endif
+      break;
+    case Configuration::RoiBackend::ROI_PERF:
+      perf_control("enable");
+      break;
+    case Configuration::RoiBackend::ROI_TRACE:
+      trace_start() = std::chrono::steady_clock::now();
+      break;
+    case Configuration::RoiBackend::ROI_NONE:
+      break;
+  }
+}
+
+inline void end(const Configuration& config, const std::string& phase) {
+  if (!selected(config, phase)) return;
+  switch (config.roi_backend) {
+    case Configuration::RoiBackend::ROI_PARSEC:
+#ifdef ENABLE_PARSEC_HOOKS
+      __parsec_roi_end();
+#endif
+      break;
+    case Configuration::RoiBackend::ROI_PERF:
+      perf_control("disable");
+      break;
+    case Configuration::RoiBackend::ROI_TRACE: {
+      using nanoseconds = std::chrono::nanoseconds;
+      auto stop = std::chrono::steady_clock::now();
+      std::cerr << "roi " << phase << ": "
+                << std::chrono::duration_cast<nanoseconds>(trace_start().time_since_epoch()).count()
+                << " - " << std::chrono::duration_cast<nanoseconds>(stop.time_since_epoch()).count()
+                << " ns (" << std::chrono::duration<double, std::milli>(stop - trace_start()).count()
+                << " ms)" << std::endl;
+    } break;
+    case Configuration::RoiBackend::ROI_NONE:
+      break;
+  }
+}
+
+/* scoped region for code that is not a benchmark() run, such as prefill */
+class region {
+ public:
+  region(const Configuration& config, const std::string& phase) : config(config), phase(phase) {
+    begin(config, phase);
+  }
+  ~region() { end(config, phase); }
+
+  region(const region&) = delete;
+  region& operator=(const region&) = delete;
+
+ private:
+  const Configuration& config;
+  std::string phase;
+};
+
+}  // namespace roi
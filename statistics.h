@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/* summary of repeated measurements of the same quantity */
+struct summary {
+  size_t n;
+  double mean;
+  double median;
+  double stddev;
+  double min;
+  double max;
+  double ci95;  // half-width of the 95% confidence interval of the mean
+};
+
+/* two-sided 97.5% quantile of Student's t distribution */
+inline double student_t975(size_t df) {
+  static const double table[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if (df == 0) return 0;
+  if (df <= sizeof(table) / sizeof(table[0])) return table[df - 1];
+  return 1.960;
+}
+
+inline summary summarize(std::vector<double> samples) {
+  summary s = {};
+  s.n = samples.size();
+  if (s.n == 0) return s;
+
+  std::sort(samples.begin(), samples.end());
+  s.min = samples.front();
+  s.max = samples.back();
+  s.median = s.n % 2 ? samples[s.n / 2]
+                     : (samples[s.n / 2 - 1] + samples[s.n / 2]) / 2;
+
+  double sum = 0;
+  for (double x : samples) sum += x;
+  s.mean = sum / s.n;
+
+  if (s.n > 1) {
+    double squares = 0;
+    for (double x : samples) squares += (x - s.mean) * (x - s.mean);
+    s.stddev = std::sqrt(squares / (s.n - 1));
+    s.ci95 = student_t975(s.n - 1) * s.stddev / std::sqrt(s.n);
+  }
+  return s;
+}